@@ -0,0 +1,171 @@
+// cSpell:ignore clazz
+// microbenchmarks for the parse and render stages, over class files generated in memory. build with `./build.sh bench`
+#define BYTECODE_DECOMP_NO_MAIN
+// the driver functions around main are not needed here
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "../bytecode-decomp.cpp"
+#pragma GCC diagnostic pop
+#include "../clazz/byte_file.h"
+#include "synthetic.h"
+#include <benchmark/benchmark.h>
+
+static std::span<const std::byte> as_input(const std::vector<uint8_t>& data) { return std::as_bytes(std::span(data)); }
+
+static const code_attribute& first_code(const class_file& c) { return std::get<code_attribute>(resolve(c, c.methods[0].attributes[0])); }
+
+static void bm_byte_file_reads(benchmark::State& state)
+{
+    std::vector<uint8_t> data(1 << 20);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = i * 131;
+
+    for (auto _ : state)
+    {
+        byte_file bf(data);
+        uint64_t sum = 0;
+        while (bf.remaining() >= 7)
+            sum += bf.read_u8() + bf.read_u16() + bf.read_u32();
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(bm_byte_file_reads);
+
+static void bm_parse_constant_pool(benchmark::State& state)
+{
+    auto data = synthetic::constant_heavy_class(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(parse_class(as_input(data), parse_options{.borrow_input = true}));
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(bm_parse_constant_pool)->Arg(100)->Arg(2000);
+
+// argument 1 stores the method as compact_code
+static void bm_parse_code(benchmark::State& state)
+{
+    auto data = synthetic::large_method_class();
+    parse_options options{.borrow_input = true, .compact_code = state.range(0) != 0};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(parse_class(as_input(data), options));
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(bm_parse_code)->Arg(0)->Arg(1);
+
+// argument 1 builds from compact_code
+static void bm_build_cfg(benchmark::State& state)
+{
+    auto data = synthetic::large_method_class();
+    auto c = parse_class(as_input(data), parse_options{.borrow_input = true, .compact_code = state.range(0) != 0});
+    const auto& code = first_code(c);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(build_cfg(code));
+    state.SetBytesProcessed(state.iterations() * code.max_ip);
+}
+BENCHMARK(bm_build_cfg)->Arg(0)->Arg(1);
+
+static void bm_analyze_frames(benchmark::State& state)
+{
+    auto data = synthetic::large_method_class();
+    auto c = parse_class(as_input(data), parse_options{.borrow_input = true, .compact_code = true});
+    const auto& code = first_code(c);
+    auto graph = build_cfg(code);
+    frame_analyzer analyzer;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(analyzer.analyze(c, c.methods[0], code, graph));
+    state.SetBytesProcessed(state.iterations() * code.max_ip);
+}
+BENCHMARK(bm_analyze_frames);
+
+static void bm_demangle_type(benchmark::State& state)
+{
+    const std::string descriptors[] = {
+        "I",
+        "Ljava/lang/String;",
+        "[[Ljava/util/Map;",
+        "(ILjava/lang/String;[JLjava/util/List;Z)V",
+        "(Ljava/lang/Object;Ljava/lang/Object;Ljava/lang/Object;Ljava/lang/Object;)[Ljava/util/concurrent/CompletableFuture;",
+    };
+    for (auto _ : state)
+        for (const auto& d : descriptors)
+            benchmark::DoNotOptimize(demangle_type(d));
+    state.SetItemsProcessed(state.iterations() * std::size(descriptors));
+}
+BENCHMARK(bm_demangle_type);
+
+// argument is the percentage of bytes that need escaping
+static void bm_escape_str(benchmark::State& state)
+{
+    std::vector<uint8_t> data(4096);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (i * 100 / data.size()) % 100 < (size_t)state.range(0) ? (uint8_t)(i % 32) : (uint8_t)('a' + i % 26);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(escape_str(data));
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(bm_escape_str)->Arg(0)->Arg(10);
+
+// argument is the percentage of characters outside of ASCII, as two byte sequences
+static void bm_validate_utf8(benchmark::State& state)
+{
+    std::vector<uint8_t> data;
+    for (size_t i = 0; data.size() < 4096; i++)
+    {
+        if ((i * 100 / 4096) % 100 < (size_t)state.range(0))
+            data.insert(data.end(), {0xc3, (uint8_t)(0x80 + i % 64)});
+        else
+            data.push_back((uint8_t)('a' + i % 26));
+    }
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(is_valid_modified_utf8(data));
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(bm_validate_utf8)->Arg(0)->Arg(10);
+
+static void bm_dump_instruction(benchmark::State& state)
+{
+    auto data = synthetic::large_method_class();
+    auto c = parse_class(as_input(data), parse_options{.borrow_input = true, .compact_code = true});
+    const auto& code = first_code(c);
+    colors_enabled = state.range(0) != 0;
+
+    size_t count = 0;
+    for (auto _ : state)
+    {
+        output_sink out;
+        output_consumer s(out, TAB_SIZE);
+        count = 0;
+        for_each_instruction(c, code, [&](size_t ip, const inst& i) {
+            dump_instruction(c, i, s, ip, code.max_ip);
+            count++;
+        });
+        benchmark::DoNotOptimize(out.view().data());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(bm_dump_instruction)->Arg(0)->Arg(1);
+
+// parse and render a whole class the way a single job does, for each output format
+static void bm_dump_class(benchmark::State& state, std::vector<uint8_t> (*make)(), output_format out_format)
+{
+    auto data = make();
+    format = out_format;
+    colors_enabled = false;
+    for (auto _ : state)
+    {
+        output_sink out;
+        render_class(parse_class(as_input(data), job_parse_options({.borrow_input = true})), "bench.class", out, nullptr);
+        benchmark::DoNotOptimize(out.view().data());
+    }
+    format = output_format::text;
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK_CAPTURE(bm_dump_class, typical_text, [] { return synthetic::typical_class(); }, output_format::text);
+BENCHMARK_CAPTURE(bm_dump_class, typical_jsonl, [] { return synthetic::typical_class(); }, output_format::jsonl);
+BENCHMARK_CAPTURE(bm_dump_class, typical_binary, [] { return synthetic::typical_class(); }, output_format::binary);
+BENCHMARK_CAPTURE(bm_dump_class, typical_xref, [] { return synthetic::typical_class(); }, output_format::xref);
+BENCHMARK_CAPTURE(bm_dump_class, large_text, [] { return synthetic::large_method_class(); }, output_format::text);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,223 @@
+// cSpell:ignore clazz
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// builds small but valid class files in memory, so the benchmarks need no corpus on disk
+namespace synthetic
+{
+    class class_builder
+    {
+        std::vector<uint8_t> pool;
+        uint16_t pool_count = 1;
+        std::vector<uint8_t> methods;
+        uint16_t method_count = 0;
+
+        static inline void put_u8(std::vector<uint8_t>& out, uint8_t v) { out.push_back(v); }
+        static inline void put_u16(std::vector<uint8_t>& out, uint16_t v)
+        {
+            out.push_back(v >> 8);
+            out.push_back(v);
+        }
+        static inline void put_u32(std::vector<uint8_t>& out, uint32_t v)
+        {
+            put_u16(out, v >> 16);
+            put_u16(out, v);
+        }
+
+        inline uint16_t add(uint8_t tag, uint16_t a, uint16_t b)
+        {
+            put_u8(pool, tag);
+            put_u16(pool, a);
+            if (tag != 7 && tag != 8)
+                put_u16(pool, b);
+            return pool_count++;
+        }
+
+    public:
+        inline uint16_t utf8(std::string_view str)
+        {
+            put_u8(pool, 1);
+            put_u16(pool, str.size());
+            pool.insert(pool.end(), str.begin(), str.end());
+            return pool_count++;
+        }
+
+        inline uint16_t integer(int32_t v)
+        {
+            put_u8(pool, 3);
+            put_u32(pool, v);
+            return pool_count++;
+        }
+
+        inline uint16_t clazz(std::string_view name) { return add(7, utf8(name), 0); }
+        inline uint16_t string(std::string_view str) { return add(8, utf8(str), 0); }
+        inline uint16_t name_and_type(std::string_view name, std::string_view desc) { return add(12, utf8(name), utf8(desc)); }
+
+        inline uint16_t methodref(std::string_view owner, std::string_view name, std::string_view desc)
+        {
+            return add(10, clazz(owner), name_and_type(name, desc));
+        }
+
+        inline uint16_t fieldref(std::string_view owner, std::string_view name, std::string_view desc)
+        {
+            return add(9, clazz(owner), name_and_type(name, desc));
+        }
+
+        inline void method(std::string_view name, std::string_view desc, const std::vector<uint8_t>& code, uint16_t max_stack, uint16_t max_locals)
+        {
+            uint16_t code_name = utf8("Code");
+            put_u16(methods, 0x0009); // public static
+            put_u16(methods, utf8(name));
+            put_u16(methods, utf8(desc));
+            put_u16(methods, 1);
+            put_u16(methods, code_name);
+            put_u32(methods, 12 + code.size());
+            put_u16(methods, max_stack);
+            put_u16(methods, max_locals);
+            put_u32(methods, code.size());
+            methods.insert(methods.end(), code.begin(), code.end());
+            put_u16(methods, 0); // exception table
+            put_u16(methods, 0); // attributes
+            method_count++;
+        }
+
+        inline std::vector<uint8_t> build(std::string_view name)
+        {
+            uint16_t this_class = clazz(name);
+            uint16_t super_class = clazz("java/lang/Object");
+
+            std::vector<uint8_t> out;
+            put_u32(out, 0xcafebabe);
+            put_u16(out, 0);
+            put_u16(out, 52);
+            put_u16(out, pool_count);
+            out.insert(out.end(), pool.begin(), pool.end());
+            put_u16(out, 0x0021); // public super
+            put_u16(out, this_class);
+            put_u16(out, super_class);
+            put_u16(out, 0); // interfaces
+            put_u16(out, 0); // fields
+            put_u16(out, method_count);
+            out.insert(out.end(), methods.begin(), methods.end());
+            put_u16(out, 0); // attributes
+            return out;
+        }
+
+        friend class code_builder;
+    };
+
+    // appends instructions, covering every operand shape the decoder distinguishes
+    class code_builder
+    {
+    public:
+        std::vector<uint8_t> code;
+
+        inline code_builder& op(uint8_t opcode)
+        {
+            code.push_back(opcode);
+            return *this;
+        }
+
+        inline code_builder& u8(uint8_t v) { return op(v); }
+
+        inline code_builder& u16(uint16_t v)
+        {
+            class_builder::put_u16(code, v);
+            return *this;
+        }
+
+        inline code_builder& u32(uint32_t v)
+        {
+            class_builder::put_u32(code, v);
+            return *this;
+        }
+
+        // switches jump to themselves (offset 0), which is always in range
+        inline code_builder& tableswitch(int32_t low, int32_t high)
+        {
+            op(0xaa);
+            while (code.size() % 4)
+                code.push_back(0);
+            u32(0).u32(low).u32(high);
+            for (int32_t i = low; i <= high; i++)
+                u32(0);
+            return *this;
+        }
+
+        inline code_builder& lookupswitch(uint32_t pairs)
+        {
+            op(0xab);
+            while (code.size() % 4)
+                code.push_back(0);
+            u32(0).u32(pairs);
+            for (uint32_t i = 0; i < pairs; i++)
+                u32(i * 7).u32(0);
+            return *this;
+        }
+    };
+
+    // a class with `count` of each of the common constant kinds and no methods
+    inline std::vector<uint8_t> constant_heavy_class(size_t count)
+    {
+        class_builder b;
+        for (size_t i = 0; i < count; i++)
+        {
+            auto n = std::to_string(i);
+            b.string("literal string number " + n);
+            b.integer(i);
+            b.methodref("com/example/Owner" + n, "method" + n, "(ILjava/lang/String;[J)Ljava/util/List;");
+            b.fieldref("com/example/Owner" + n, "field" + n, "Ljava/util/Map;");
+        }
+        return b.build("com/example/Constants");
+    }
+
+    // a class whose only method is close to the 64k code size limit, built from a mix of all operand kinds
+    inline std::vector<uint8_t> large_method_class(size_t code_size = 60000)
+    {
+        class_builder b;
+        uint16_t out = b.fieldref("java/lang/System", "out", "Ljava/io/PrintStream;");
+        uint16_t println = b.methodref("java/io/PrintStream", "println", "(Ljava/lang/String;)V");
+        uint16_t str = b.string("hello");
+        uint16_t list = b.clazz("java/util/ArrayList");
+
+        code_builder c;
+        for (size_t round = 0; c.code.size() < code_size; round++)
+        {
+            c.op(0x1b).op(0x04).op(0x60).op(0x3c);           // iload_1 iconst_1 iadd istore_1
+            c.op(0x84).u8(2).u8(0xff);                       // iinc 2 -1
+            c.op(0x10).u8(0x80).op(0x11).u16(0x1234).op(0x5c); // bipush sipush pop2
+            c.op(0xb2).u16(out).op(0x12).u8(str).op(0xb6).u16(println);
+            c.op(0xbb).u16(list).op(0x57);                   // new pop
+            c.op(0x15).u8(3).op(0x36).u8(4);                 // iload 3 istore 4
+            c.op(0xc4).op(0x15).u16(300).op(0x57);           // wide iload 300 pop
+            c.op(0xa7).u16(3);                               // goto next
+            if (round % 64 == 0)
+                c.op(0x1b).tableswitch(0, 15);
+            else if (round % 64 == 32)
+                c.op(0x1b).lookupswitch(8);
+        }
+        c.op(0xb1); // return
+        b.method("big", "()V", c.code, 8, 301);
+        return b.build("com/example/Large");
+    }
+
+    // something shaped like ordinary application code: a few dozen small methods over a shared constant pool
+    inline std::vector<uint8_t> typical_class(size_t methods = 40)
+    {
+        class_builder b;
+        uint16_t out = b.fieldref("java/lang/System", "out", "Ljava/io/PrintStream;");
+        uint16_t println = b.methodref("java/io/PrintStream", "println", "(Ljava/lang/String;)V");
+        for (size_t m = 0; m < methods; m++)
+        {
+            code_builder c;
+            for (int i = 0; i < 20; i++)
+                c.op(0xb2).u16(out).op(0x13).u16(b.string("message " + std::to_string(m * 20 + i))).op(0xb6).u16(println);
+            c.op(0xb1);
+            b.method("method" + std::to_string(m), "()V", c.code, 2, 0);
+        }
+        return b.build("com/example/Typical");
+    }
+} // namespace synthetic
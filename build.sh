@@ -1,5 +1,5 @@
 if [ $# -ne 1 ]; then
-    >&2 echo "usage: $0 [release|debug|install]"
+    >&2 echo "usage: $0 [release|debug|install|bench|classgen|fuzz]"
     exit -1
 fi
 
@@ -10,22 +10,31 @@ ex() {
 
 case $1 in
   release)
-    ex clang++ bytecode-decomp.cpp clazz/clazz.cpp -DFMT_HEADER_ONLY -std=c++20 -O3 -Wall -o bytecode-decomp
+    ex clang++ bytecode-decomp.cpp clazz/clazz.cpp clazz/cfg.cpp clazz/frames.cpp clazz/xref.cpp clazz/zip.cpp clazz/binary_dump.cpp -DFMT_HEADER_ONLY -std=c++20 -O3 -Wall -lz -pthread -o bytecode-decomp
     ex strip bytecode-decomp
     ;;
   release-symbols)
-    ex clang++ bytecode-decomp.cpp clazz/clazz.cpp -DFMT_HEADER_ONLY -std=c++20 -O3 -Wall -o bytecode-decomp
+    ex clang++ bytecode-decomp.cpp clazz/clazz.cpp clazz/cfg.cpp clazz/frames.cpp clazz/xref.cpp clazz/zip.cpp clazz/binary_dump.cpp -DFMT_HEADER_ONLY -std=c++20 -O3 -Wall -lz -pthread -o bytecode-decomp
     ;;
   debug)
-    ex clang++ bytecode-decomp.cpp clazz/clazz.cpp -DFMT_HEADER_ONLY -std=c++20 -fsanitize=address,undefined -ggdb -O0 -Wall -o bytecode-decomp
+    ex clang++ bytecode-decomp.cpp clazz/clazz.cpp clazz/cfg.cpp clazz/frames.cpp clazz/xref.cpp clazz/zip.cpp clazz/binary_dump.cpp -DFMT_HEADER_ONLY -std=c++20 -fsanitize=address,undefined -ggdb -O0 -Wall -lz -pthread -o bytecode-decomp
+    ;;
+  bench)
+    ex clang++ bench/bench.cpp clazz/clazz.cpp clazz/cfg.cpp clazz/frames.cpp clazz/xref.cpp clazz/zip.cpp clazz/binary_dump.cpp -DFMT_HEADER_ONLY -std=c++20 -O3 -Wall -lbenchmark -lz -pthread -o bytecode-decomp-bench
+    ;;
+  fuzz)
+    ex clang++ fuzz/fuzz_parse_class.cpp clazz/clazz.cpp clazz/cfg.cpp clazz/frames.cpp clazz/xref.cpp clazz/class_writer.cpp -std=c++20 -O1 -g -fsanitize=fuzzer,address,undefined -o bytecode-decomp-fuzz
+    ;;
+  classgen)
+    ex clang++ classgen/classgen.cpp clazz/clazz.cpp clazz/class_writer.cpp -DFMT_HEADER_ONLY -std=c++20 -O3 -Wall -pthread -o bytecode-decomp-classgen
     ;;
   install)
-    ex clang++ bytecode-decomp.cpp clazz/clazz.cpp -DFMT_HEADER_ONLY -std=c++20 -O3 -Wall -o bytecode-decomp
+    ex clang++ bytecode-decomp.cpp clazz/clazz.cpp clazz/cfg.cpp clazz/frames.cpp clazz/xref.cpp clazz/zip.cpp clazz/binary_dump.cpp -DFMT_HEADER_ONLY -std=c++20 -O3 -Wall -lz -pthread -o bytecode-decomp
     ex strip bytecode-decomp
     ex install bytecode-decomp /usr/local/bin/
     ;;
   *)
-    >&2 echo "usage: $0 [release|debug|install]"
+    >&2 echo "usage: $0 [release|debug|install|bench|classgen|fuzz]"
     exit -1
     ;;
 esac
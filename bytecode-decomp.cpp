@@ -1,11 +1,36 @@
 // cSpell:ignore clazz
+#include "clazz/binary_dump.h"
+#include "clazz/cfg.h"
 #include "clazz/clazz.h"
+#include "clazz/frames.h"
+#include "clazz/mapped_file.h"
+#include "clazz/stats.h"
+#include "clazz/xref.h"
+#include "clazz/zip.h"
 #include "colors.h"
+#include "descriptor_cache.h"
+#include "json_writer.h"
+#include "manifest.h"
+#include "output_cache.h"
+#include "task_pool.h"
 #include "utils.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
 #include <fmt/ranges.h>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <optional>
 #include <ranges>
+#include <set>
 #include <stdexcept>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 
 using namespace clazz;
 namespace stackmap = stackmap;
@@ -13,19 +38,19 @@ namespace stackmap = stackmap;
 template <typename T>
 concept not_str = !std::is_convertible_v<std::decay_t<T>, std::string>;
 
-constexpr std::string member(const std::string& str) { return cyan(str); }
-constexpr std::string desc(const std::string& str) { return magenta(str); }
-constexpr std::string type(const std::string& str) { return yellow(str); }
-constexpr std::string utf8(const std::string& str) { return bright_black(str); }
-constexpr std::string flags(const std::string& s) { return bright_red(s); }
-constexpr std::string key(const std::string& str) { return bright_blue(str); }
-constexpr std::string constant(const std::string& str) { return green(str); }
-constexpr std::string instruction(const std::string& str) { return bright_yellow(str); }
-constexpr std::string address(const std::string& str) { return bright_red(str); }
-constexpr std::string reference(const std::string& str) { return bright_green(str); }
-constexpr std::string pretty(const std::string& str) { return bright_green(str); }
-constexpr std::string magic(const std::string& str) { return bright_red(str); }
-constexpr std::string annotation(const std::string& str) { return bright_yellow(str); }
+constexpr std::string member(std::string str) { return cyan(std::move(str)); }
+constexpr std::string desc(std::string str) { return magenta(std::move(str)); }
+constexpr std::string type(std::string str) { return yellow(std::move(str)); }
+constexpr std::string utf8(std::string str) { return bright_black(std::move(str)); }
+constexpr std::string flags(std::string s) { return bright_red(std::move(s)); }
+constexpr std::string key(std::string str) { return bright_blue(std::move(str)); }
+constexpr std::string constant(std::string str) { return green(std::move(str)); }
+constexpr std::string instruction(std::string str) { return bright_yellow(std::move(str)); }
+constexpr std::string address(std::string str) { return bright_red(std::move(str)); }
+constexpr std::string reference(std::string str) { return bright_green(std::move(str)); }
+constexpr std::string pretty(std::string str) { return bright_green(std::move(str)); }
+constexpr std::string magic(std::string str) { return bright_red(std::move(str)); }
+constexpr std::string annotation(std::string str) { return bright_yellow(std::move(str)); }
 
 constexpr std::string member(const not_str auto& str) { return cyan(std::to_string(str)); }
 constexpr std::string desc(const not_str auto& str) { return magenta(std::to_string(str)); }
@@ -49,6 +74,10 @@ constexpr std::string fmt_constant(const fmt::format_string<Ts...>& a, Ts&&... a
 
 inline static constexpr auto TAB_SIZE = 2;
 
+// set from the command line: code listings show the simulated operand stack height before every instruction and how
+// the StackMapTable disagrees with it
+static bool show_stack = false;
+
 constexpr std::string flags_to_string(const auto& map, auto flags)
 {
     std::string str;
@@ -58,28 +87,91 @@ constexpr std::string flags_to_string(const auto& map, auto flags)
     return ::flags(str);
 }
 
+// where rendered text ends up: either kept in memory (for results that have to be reordered first) or written to a
+// file descriptor in chunks, so that a dump never has to be held as a whole
+class output_sink
+{
+    int fd;
+    fmt::memory_buffer buffer;
+
+public:
+    inline static constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    inline output_sink(int fd = -1) : fd(fd) {}
+
+    constexpr fmt::memory_buffer& buf() { return buffer; }
+    constexpr std::string_view view() const { return {buffer.data(), buffer.size()}; }
+
+    inline void append(std::string_view str) { buffer.append(str.data(), str.data() + str.size()); }
+
+    inline void maybe_flush()
+    {
+        if (fd >= 0 && buffer.size() >= FLUSH_THRESHOLD)
+            flush();
+    }
+
+    inline void flush()
+    {
+        if (fd < 0)
+            return;
+
+        stats::scoped_phase timer(stats::phase::write);
+        stats::add(stats::counter::output_bytes, buffer.size());
+
+        const char* p = buffer.data();
+        size_t left = buffer.size();
+        while (left)
+        {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw std::runtime_error("unable to write output");
+            p += n;
+            left -= n;
+        }
+        buffer.clear();
+    }
+};
+
 class output_consumer
 {
+    output_sink& sink;
     const size_t tab_len;
     size_t indent;
-    std::string buffer;
     std::string prefix;
 
+    constexpr void begin_line()
+    {
+        auto& out = sink.buf();
+        std::fill_n(std::back_inserter(out), tab_len * indent, ' ');
+        out.append(prefix.data(), prefix.data() + prefix.size());
+        prefix.clear();
+    }
+
+    constexpr void end_line()
+    {
+        sink.buf().push_back('\n');
+        sink.maybe_flush();
+    }
+
 public:
-    constexpr output_consumer(size_t tab_len) : tab_len(tab_len), indent(0) {}
+    constexpr output_consumer(output_sink& sink, size_t tab_len) : sink(sink), tab_len(tab_len), indent(0) {}
 
     constexpr output_consumer& w(const std::string& str)
     {
-        buffer += std::string(tab_len * indent, ' ') + prefix + str + '\n';
-        prefix.clear();
+        begin_line();
+        sink.append(str);
+        end_line();
         return *this;
     }
 
     template <typename... Ts>
     constexpr output_consumer& w(const fmt::format_string<Ts...>& str, Ts&&... args)
     {
-        buffer += std::string(tab_len * indent, ' ') + prefix + fmt::format(str, std::forward<Ts>(args)...) + '\n';
-        prefix.clear();
+        begin_line();
+        fmt::format_to(std::back_inserter(sink.buf()), str, std::forward<Ts>(args)...);
+        end_line();
         return *this;
     }
 
@@ -98,7 +190,6 @@ public:
 
     constexpr void push(size_t off = 1) { indent += off; }
     constexpr void pop(size_t off = 1) { indent -= off; }
-    constexpr const std::string& data() const { return buffer; };
 };
 
 constexpr std::string dump_ref(const class_file& clazz, utf8_ref ref) { return escape_str(ref.get(clazz).bytes); }
@@ -198,8 +289,8 @@ constexpr std::string dump_info(const class_file& clazz, invoke_dynamic_info ref
                        desc(dump_ref(clazz, ref.name_and_type_index.get(clazz).descriptor_index)));
 }
 
-constexpr std::string pretty_demangle(const class_file& clazz, const utf8_info& ref) { return pretty(demangle_type(escape_str(ref.bytes))); }
-constexpr std::string pretty_demangle(const class_file& clazz, utf8_ref ref) { return pretty(demangle_type(escape_str(ref.get(clazz).bytes))); }
+constexpr std::string pretty_demangle(const class_file& clazz, const utf8_info& ref) { return pretty(descriptor_table::global().demangle(ref.bytes)); }
+constexpr std::string pretty_demangle(const class_file& clazz, utf8_ref ref) { return pretty(class_descriptors::demangle(clazz, ref)); }
 
 constexpr std::string pretty_demangle(const class_file& clazz, name_and_type_info ref) { return pretty_demangle(clazz, ref.descriptor_index); }
 constexpr std::string pretty_demangle(const class_file& clazz, name_and_type_ref ref)
@@ -255,21 +346,16 @@ struct fmt::formatter<address_ref>
     }
 };
 
-static std::string dump_class_header(const class_file& clazz)
+static void dump_class_header(const class_file& clazz, output_consumer& s)
 {
-    output_consumer s(TAB_SIZE);
-
     s.w("{}: {}", key("magic"), magic(fmt::format("0x{:x}", clazz.magic)));
     s.w("{}: {}.{}", key("version"), constant(clazz.major_version), constant(clazz.minor_version));
     s.w("{}{} {} {}", flags_to_string(CLASS_FLAGS_NAMES, clazz.access_flags), dump_ref(clazz, clazz.this_class), key("extends"),
         dump_ref(clazz, clazz.super_class));
-
-    return s.data();
 }
 
-static std::string dump_constant_pool(const class_file& clazz)
+static void dump_constant_pool(const class_file& clazz, output_consumer& s)
 {
-    output_consumer s(TAB_SIZE);
     s.w("{} ({}):", key("constants"), constant(clazz.constant_pool.size()));
 
     std::size_t index = 1;
@@ -280,7 +366,9 @@ static std::string dump_constant_pool(const class_file& clazz)
         std::visit(
             overload{
                 [](std::monostate) {},
-                [&s](const utf8_info& info) { s.w("utf8_info:                 {}", utf8(dump_info(info))); },
+                [&s](const utf8_info& info) {
+                    s.w("utf8_info:                 {}{}", utf8(dump_info(info)), is_valid_modified_utf8(info.bytes) ? "" : " (malformed)");
+                },
                 [&s](integer_info info) { s.w("integer_info:              {}", dump_info(info)); },
                 [&s](float_info info) { s.w("float_info:                {}", dump_info(info)); },
                 [&s](long_info info) { s.w("long_info:                 {}", dump_info(info)); },
@@ -321,15 +409,15 @@ static std::string dump_constant_pool(const class_file& clazz)
         s.pop();
         index++;
     }
-
-    return s.data();
 }
 
-static void dump_instruction(const class_file& clazz, const inst& i, output_consumer& s, size_t ip, size_t max_sz)
+// `stack` goes between the address and the mnemonic, empty unless --stack is given
+static void dump_instruction(const class_file& clazz, const inst& i, output_consumer& s, size_t ip, size_t max_sz, const std::string& stack = {})
 {
-    std::string buf = instruction(fmt::format("{: <16} ", i.opcode <= 0xca ? opcodes[i.opcode] : "<bad opcode>"));
+    const opcode_info& info = opcode_table[i.opcode];
+    std::string buf = stack + instruction(fmt::format("{: <16} ", info.name));
 
-    if (i.opcode == 0xaa)
+    if (info.kind == operand_kind::tableswitch)
     {
         const tableswitch_data& data = std::get<tableswitch_data>(i.special);
         s.w("{}:{} {} (def, hi, lo) = {} {} {}", address_ref(ip), get_padding(max_sz, ip), buf, data.def.resolve(ip), constant(data.high),
@@ -340,7 +428,7 @@ static void dump_instruction(const class_file& clazz, const inst& i, output_cons
         s.pop(2);
         return;
     }
-    else if (i.opcode == 0xab)
+    else if (info.kind == operand_kind::lookupswitch)
     {
         const lookupswitch_data& data = std::get<lookupswitch_data>(i.special);
 
@@ -352,8 +440,8 @@ static void dump_instruction(const class_file& clazz, const inst& i, output_cons
 
         return;
     }
-    else if (i.opcode == 0xc4)
-        buf = instruction(fmt::format("w.{: <14} ", opcodes[std::get<wide_data>(i.special).op]));
+    else if (info.kind == operand_kind::wide)
+        buf = stack + instruction(fmt::format("w.{: <14} ", opcode_table[std::get<wide_data>(i.special).op].name));
 
     buf += std::visit(
         overload{
@@ -385,22 +473,55 @@ static void dump_instruction(const class_file& clazz, const inst& i, output_cons
     s.w("{}:{} {}", address_ref(ip), get_padding(max_sz, ip), buf);
 }
 
-static void dump_attribute(const class_file& clazz, const attribute& attr, output_consumer& s);
+static void dump_attribute(const class_file& clazz, const attribute& attr, output_consumer& s, const method_info* method = nullptr);
 
-static void dump_code_attribute(const class_file& clazz, const code_attribute& attr, output_consumer& s)
+// the stack height column of --stack, padded to the widest height max_stack allows
+static std::string stack_height(int32_t height, uint16_t max_stack)
+{
+    if (height < 0)
+        return fmt::format("[-]{} ", get_padding(max_stack, 0));
+    return fmt::format("[{}]{} ", constant(height), get_padding(std::max<int32_t>(max_stack, height), height));
+}
+
+static void dump_code_attribute(const class_file& clazz, const code_attribute& attr, output_consumer& s, const method_info* method = nullptr)
 {
     s.w("- Code");
     s.push();
     s.w("{}: {}", key("max_locals"), constant(attr.max_locals));
     s.w("{}: {}", key("max_stack"), constant(attr.max_stack));
-    size_t ip = 0;
-    s.push();
-    for (const auto& i : attr.code)
+
+    // the analyzer keeps its buffers for the next method rendered on this thread
+    thread_local frame_analyzer analyzer;
+    const frame_analysis* frames = nullptr;
+    std::string stack_error;
+    if (show_stack && method)
     {
-        dump_instruction(clazz, i, s, ip, attr.max_ip);
-        ip += i.inst_sz;
+        try
+        {
+            frames = &analyzer.analyze(clazz, *method, attr, build_cfg(attr));
+        }
+        catch (const class_parse_error& e)
+        {
+            stack_error = e.what();
+        }
     }
+
+    s.push();
+    size_t index = 0;
+    for_each_instruction(clazz, attr, [&](size_t ip, const inst& i) {
+        dump_instruction(clazz, i, s, ip, attr.max_ip, frames ? stack_height(frames->heights[index++], attr.max_stack) : std::string());
+    });
     s.pop();
+    if (frames)
+    {
+        s.w("{} ({}):", key("stack_map_mismatches"), constant(frames->mismatches.size()));
+        s.push();
+        for (const auto& i : frames->mismatches)
+            s.w("{}: {}", address_ref(i.ip), i.message);
+        s.pop();
+    }
+    else if (!stack_error.empty())
+        s.w("{}: {}", key("stack_map_mismatches"), stack_error);
     s.w("{} ({}):", key("exception_table"), constant(attr.exception_table.size()));
     s.push();
 
@@ -627,11 +748,11 @@ static std::string dump_element_value(const class_file& clazz, const annotations
         return fmt::format("{}.{}", type(dump_ref(clazz, info.type_name_index)), member(dump_ref(clazz, info.const_name_index)));
     }
     case 'c':
-        return fmt::format("{}.{}", type(demangle_type(dump_ref(clazz, std::get<utf8_ref>(a.value)))), key("class"));
+        return fmt::format("{}.{}", type(class_descriptors::demangle(clazz, std::get<utf8_ref>(a.value))), key("class"));
     case '@':
         return dump_annotation(clazz, std::get<annotations::annotation>(a.value));
     case '[': {
-        const auto& arr = std::get<std::vector<annotations::element_value>>(a.value);
+        const auto& arr = std::get<std::pmr::vector<annotations::element_value>>(a.value);
         std::string out = "{";
         for (size_t i = 0; i < arr.size(); i++)
         {
@@ -647,7 +768,7 @@ static std::string dump_element_value(const class_file& clazz, const annotations
 
 static std::string dump_annotation(const class_file& clazz, const annotations::annotation& a)
 {
-    std::string out = annotation('@' + demangle_type(dump_ref(clazz, a.type_index)));
+    std::string out = annotation('@' + class_descriptors::demangle(clazz, a.type_index));
     out += '(';
     for (size_t i = 0; i < a.entries.size(); i++)
     {
@@ -660,7 +781,7 @@ static std::string dump_annotation(const class_file& clazz, const annotations::a
 
 static std::string dump_type_annotation(const class_file& clazz, const annotations::type_annotation& a)
 {
-    std::string out = annotation('@' + demangle_type(dump_ref(clazz, a.type_index)));
+    std::string out = annotation('@' + class_descriptors::demangle(clazz, a.type_index));
     out += '(';
     for (size_t i = 0; i < a.entries.size(); i++)
     {
@@ -671,11 +792,12 @@ static std::string dump_type_annotation(const class_file& clazz, const annotatio
     return out + ')';
 }
 
-static void dump_attribute(const class_file& clazz, const attribute& attr, output_consumer& s)
+static void dump_attribute(const class_file& clazz, const attribute& attr, output_consumer& s, const method_info* method)
 {
     std::visit(overload{
                    [&s, &clazz](const attribute_info& info) { s.w("- {} (unknown)", dump_ref(clazz, info.attribute_name_index)); },
-                   [&clazz, &s](const code_attribute& attr) { dump_code_attribute(clazz, attr, s); },
+                   [](const lazy_attribute&) {}, // not reached, the attribute is resolved before visiting
+                   [&clazz, &s, method](const code_attribute& attr) { dump_code_attribute(clazz, attr, s, method); },
                    [&s, &clazz](const signature_attribute& attr) { s.w("- Signature: {}", type(escape_str(attr.signature_index.get(clazz).bytes))); },
                    [&s, &clazz](const source_file_attribute& attr) { s.w("- SourceFile: {}", escape_str(attr.sourcefile_index.get(clazz).bytes)); },
                    [&s, &clazz](const lvt_attribute& attr) {
@@ -811,12 +933,11 @@ static void dump_attribute(const class_file& clazz, const attribute& attr, outpu
                        s.pop();
                    },
                },
-               attr);
+               resolve(clazz, attr));
 }
 
-static std::string dump_fields(const class_file& clazz)
+static void dump_fields(const class_file& clazz, output_consumer& s)
 {
-    output_consumer s(TAB_SIZE);
     s.w("{} ({}):", key("fields"), constant(clazz.fields.size()));
     s.push();
 
@@ -834,72 +955,1184 @@ static std::string dump_fields(const class_file& clazz)
     }
 
     s.pop();
-    return s.data();
 }
 
-static std::string dump_methods(const class_file& clazz)
+static void dump_method(const class_file& clazz, const method_info& method, output_consumer& s)
+{
+    s.w("{}{}{} ({})", flags_to_string(METHOD_FLAGS_NAMES, method.access_flags), member(dump_ref(clazz, method.name_index)),
+        desc(dump_ref(clazz, method.descriptor_index)), pretty_demangle(clazz, method.descriptor_index));
+
+    s.push();
+    s.w("{} ({}):", key("attributes"), constant(method.attributes.size()));
+    s.push();
+    for (const auto& attr : method.attributes)
+        dump_attribute(clazz, attr, s, &method);
+    s.pop(2);
+}
+
+// bytes of bytecode rendered per task when a class is split across the pool
+inline static constexpr size_t METHOD_SPLIT_GRAIN = 8192;
+
+static size_t code_size(const method_info& method)
 {
-    output_consumer s(TAB_SIZE);
+    size_t sz = 0;
+    for (const auto& attr : method.attributes)
+    {
+        if (const auto* code = std::get_if<code_attribute>(&attr))
+            sz += code->max_ip;
+        else if (const auto* lazy = std::get_if<lazy_attribute>(&attr))
+            sz += lazy->bytes.size(); // close enough for splitting, and avoids decoding
+    }
+    return sz;
+}
+
+static void dump_methods(const class_file& clazz, output_sink& out, task_pool* pool = nullptr)
+{
+    output_consumer s(out, TAB_SIZE);
     s.w("{} ({}):", key("methods"), constant(clazz.methods.size()));
     s.push();
 
-    for (const auto& method : clazz.methods)
+    // split points are method boundaries; consecutive small methods are batched so that each task renders at least
+    // METHOD_SPLIT_GRAIN bytes of code
+    std::vector<std::pair<size_t, size_t>> chunks;
+    size_t begin = 0, acc = 0;
+    for (size_t i = 0; i < clazz.methods.size(); i++)
     {
-        s.w("{}{}{} ({})", flags_to_string(METHOD_FLAGS_NAMES, method.access_flags), member(dump_ref(clazz, method.name_index)),
-            desc(dump_ref(clazz, method.descriptor_index)), pretty_demangle(clazz, method.descriptor_index));
+        acc += code_size(clazz.methods[i]);
+        if (acc >= METHOD_SPLIT_GRAIN || i + 1 == clazz.methods.size())
+        {
+            chunks.emplace_back(begin, i + 1);
+            begin = i + 1;
+            acc = 0;
+        }
+    }
 
-        s.push();
-        s.w("{} ({}):", key("attributes"), constant(method.attributes.size()));
-        s.push();
-        for (const auto& attr : method.attributes)
-            dump_attribute(clazz, attr, s);
-        s.pop(2);
+    if (!pool || chunks.size() < 2)
+    {
+        for (const auto& method : clazz.methods)
+            dump_method(clazz, method, s);
+        return;
     }
 
-    s.pop();
-    return s.data();
+    std::vector<output_sink> parts(chunks.size());
+    const class_descriptors* descriptors = class_descriptors::active();
+    task_group group(*pool);
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        group.run([&clazz, &parts, &chunks, descriptors, i]() {
+            class_descriptors::scope use(descriptors);
+            output_consumer part(parts[i], TAB_SIZE);
+            part.push();
+            for (size_t j = chunks[i].first; j < chunks[i].second; j++)
+                dump_method(clazz, clazz.methods[j], part);
+        });
+    }
+    group.wait();
+
+    for (auto& i : parts)
+    {
+        out.append(i.view());
+        out.maybe_flush();
+    }
 }
 
-static std::string dump_class_attributes(const class_file& clazz)
+static void dump_class_attributes(const class_file& clazz, output_consumer& s)
 {
-    output_consumer s(TAB_SIZE);
     s.w("{} ({}):", key("attributes"), constant(clazz.attributes.size()));
     s.push();
     for (const auto& i : clazz.attributes)
         dump_attribute(clazz, i, s);
     s.pop();
-    return s.data();
+}
+
+static void dump_class(const class_file& c, output_sink& out, task_pool* pool = nullptr)
+{
+    class_descriptors descriptors(c);
+    class_descriptors::scope use(&descriptors);
+    output_consumer s(out, TAB_SIZE);
+    dump_class_header(c, s);
+    dump_constant_pool(c, s);
+    dump_fields(c, s);
+    dump_methods(c, out, pool);
+    dump_class_attributes(c, s);
+}
+
+static std::string_view utf8_view(const class_file& clazz, utf8_ref ref)
+{
+    const auto& bytes = ref.get(clazz).bytes;
+    return {(const char*)bytes.data(), bytes.size()};
+}
+
+static void json_constant(json_writer& j, const class_file& clazz, const cp_info& entry)
+{
+    auto member = [&](const char* tag, const auto& info) {
+        const auto& nat = info.name_and_type_index.get(clazz);
+        j.field("tag", tag)
+            .field("class", utf8_view(clazz, info.class_index.get(clazz).name_index))
+            .field("name", utf8_view(clazz, nat.name_index))
+            .field("descriptor", utf8_view(clazz, nat.descriptor_index));
+    };
+
+    std::visit(overload{
+                   [](std::monostate) {},
+                   [&](const utf8_info& info) { j.field("tag", "utf8").field("value", std::string_view((const char*)info.bytes.data(), info.bytes.size())); },
+                   [&](integer_info info) { j.field("tag", "integer").field("value", info.value); },
+                   [&](float_info info) { j.field("tag", "float").field("value", info.value); },
+                   [&](long_info info) { j.field("tag", "long").field("value", info.value); },
+                   [&](double_info info) { j.field("tag", "double").field("value", info.value); },
+                   [&](class_info info) { j.field("tag", "class").field("name", utf8_view(clazz, info.name_index)); },
+                   [&](string_info info) { j.field("tag", "string").field("value", utf8_view(clazz, info.string_index)); },
+                   [&](fieldref_info info) { member("fieldref", info); },
+                   [&](methodref_info info) { member("methodref", info); },
+                   [&](interface_methodref_info info) { member("interface_methodref", info); },
+                   [&](name_and_type_info info) {
+                       j.field("tag", "name_and_type")
+                           .field("name", utf8_view(clazz, info.name_index))
+                           .field("descriptor", utf8_view(clazz, info.descriptor_index));
+                   },
+                   [&](method_handle_info info) {
+                       j.field("tag", "method_handle").field("kind", METHOD_HANDLE_REF_TYPES[info.reference_kind]);
+                       j.key("reference").begin_object();
+                       json_constant(j, clazz, clazz.constant_pool[info.reference_index.get_index() - 1]);
+                       j.end_object();
+                   },
+                   [&](method_type_info info) { j.field("tag", "method_type").field("descriptor", utf8_view(clazz, info.descriptor_index)); },
+                   [&](invoke_dynamic_info info) {
+                       const auto& nat = info.name_and_type_index.get(clazz);
+                       j.field("tag", "invoke_dynamic")
+                           .field("bootstrap", info.bootstrap_method_attr_index)
+                           .field("name", utf8_view(clazz, nat.name_index))
+                           .field("descriptor", utf8_view(clazz, nat.descriptor_index));
+                   },
+               },
+               entry);
+}
+
+static void json_instruction(json_writer& j, const class_file& clazz, const inst& i, size_t ip)
+{
+    const opcode_info& info = opcode_table[i.opcode];
+    j.begin_object().field("ip", ip);
+
+    if (info.kind == operand_kind::wide)
+        j.field("op", opcode_table[std::get<wide_data>(i.special).op].name).field("wide", true);
+    else
+        j.field("op", info.name);
+
+    std::visit(overload{
+                   [](std::monostate) {},
+                   [&](int v) { j.field("value", v); },
+                   [&](lvt_ref ref) { j.field("local", ref.index); },
+                   [&](address_offset ref) { j.field("target", ref.resolve(ip).ip); },
+                   [&](primitive_type_ref ref) { j.field("type", ref.name()); },
+                   [&](auto ref) {
+                       j.field("ref", ref.get_index());
+                       j.key("constant").begin_object();
+                       json_constant(j, clazz, clazz.constant_pool[ref.get_index() - 1]);
+                       j.end_object();
+                   },
+               },
+               i.operand1);
+
+    if (const int* v = std::get_if<int>(&i.operand2))
+    {
+        const operand_kind kind = info.kind == operand_kind::wide ? operand_kind::iinc : info.kind;
+        j.field(kind == operand_kind::iinc ? "delta" : kind == operand_kind::interface_method ? "count" : "dimensions", *v);
+    }
+
+    std::visit(overload{
+                   [](std::monostate) {},
+                   [](wide_data) {},
+                   [&](const tableswitch_data& data) {
+                       j.field("default", data.def.resolve(ip).ip).field("low", data.low).field("high", data.high);
+                       j.key("targets").begin_array();
+                       for (auto off : data.lut)
+                           j.value(off.resolve(ip).ip);
+                       j.end_array();
+                   },
+                   [&](const lookupswitch_data& data) {
+                       j.field("default", data.def.resolve(ip).ip);
+                       j.key("pairs").begin_array();
+                       for (const auto& [match, off] : data.lut)
+                           j.begin_array().value(match).value(off.resolve(ip).ip).end_array();
+                       j.end_array();
+                   },
+               },
+               i.special);
+
+    j.end_object();
+}
+
+static void json_attributes(json_writer& j, const class_file& clazz, const std::pmr::vector<attribute>& attrs);
+
+static void json_attribute(json_writer& j, const class_file& clazz, const attribute& attr)
+{
+    const attribute& decoded = resolve(clazz, attr);
+    j.begin_object();
+
+    std::visit(
+        [&]<typename T>(const T& a) {
+            if constexpr (std::is_same_v<T, attribute_info>)
+                j.field("name", utf8_view(clazz, a.attribute_name_index)).field("length", a.buffer.size());
+            else if constexpr (!std::is_same_v<T, lazy_attribute>)
+                j.field("name", attribute_name<T>());
+
+            if constexpr (std::is_same_v<T, code_attribute>)
+            {
+                j.field("max_stack", a.max_stack).field("max_locals", a.max_locals).field("code_length", a.max_ip);
+                j.key("instructions").begin_array();
+                for_each_instruction(clazz, a, [&](size_t ip, const inst& i) { json_instruction(j, clazz, i, ip); });
+                j.end_array();
+
+                j.key("exception_table").begin_array();
+                for (const auto& i : a.exception_table)
+                {
+                    j.begin_object().field("start", i.start_pc.ip).field("end", i.end_pc.ip).field("handler", i.handler_pc.ip).key("catch_type");
+                    if (i.catch_type.has_value())
+                        j.value(utf8_view(clazz, i.catch_type.get(clazz).name_index));
+                    else
+                        j.null();
+                    j.end_object();
+                }
+                j.end_array();
+
+                json_attributes(j, clazz, a.attributes);
+            }
+            else if constexpr (std::is_same_v<T, signature_attribute>)
+                j.field("signature", utf8_view(clazz, a.signature_index));
+            else if constexpr (std::is_same_v<T, source_file_attribute>)
+                j.field("source_file", utf8_view(clazz, a.sourcefile_index));
+            else if constexpr (std::is_same_v<T, constant_value_attribute>)
+            {
+                j.key("value").begin_object();
+                json_constant(j, clazz, clazz.constant_pool[a.constantvalue_index.get_index() - 1]);
+                j.end_object();
+            }
+            else if constexpr (std::is_same_v<T, exceptions_attribute>)
+            {
+                j.key("exceptions").begin_array();
+                for (auto i : a.exception_index_table)
+                    j.value(utf8_view(clazz, i.get(clazz).name_index));
+                j.end_array();
+            }
+            else if constexpr (std::is_same_v<T, lineno_attribute>)
+            {
+                j.key("lines").begin_array();
+                for (const auto& i : a.line_number_table)
+                    j.begin_array().value(i.start_pc.ip).value(i.line_number).end_array();
+                j.end_array();
+            }
+            else if constexpr (!std::is_same_v<T, attribute_info> && !std::is_same_v<T, lazy_attribute>)
+            {
+                // everything else is passed on as the text rendering, minus the title line
+                output_sink text;
+                output_consumer s(text, TAB_SIZE);
+                dump_attribute(clazz, decoded, s);
+
+                j.key("text").begin_array();
+                auto lines = text.view();
+                lines.remove_prefix(std::min(lines.size(), lines.find('\n') + 1));
+                while (!lines.empty())
+                {
+                    size_t end = lines.find('\n');
+                    j.value(lines.substr(0, end));
+                    lines.remove_prefix(end + 1);
+                }
+                j.end_array();
+            }
+        },
+        decoded);
+
+    j.end_object();
+}
+
+static void json_attributes(json_writer& j, const class_file& clazz, const std::pmr::vector<attribute>& attrs)
+{
+    j.key("attributes").begin_array();
+    for (const auto& i : attrs)
+        json_attribute(j, clazz, i);
+    j.end_array();
+}
+
+template <typename T>
+static void json_members(json_writer& j, const class_file& clazz, const char* name, const std::pmr::vector<T>& members, output_sink& out)
+{
+    j.key(name).begin_array();
+    for (const auto& m : members)
+    {
+        j.begin_object()
+            .field("name", utf8_view(clazz, m.name_index))
+            .field("descriptor", utf8_view(clazz, m.descriptor_index))
+            .field("access_flags", m.access_flags);
+        json_attributes(j, clazz, m.attributes);
+        j.end_object();
+        out.maybe_flush();
+    }
+    j.end_array();
+}
+
+// one JSON object per class on a single line, covering the same data as the text dump
+static void dump_class_json(const class_file& c, const std::string& name, output_sink& out)
+{
+    json_writer j(out.buf());
+    j.begin_object()
+        .field("source", name)
+        .field("class", utf8_view(c, c.this_class.get(c).name_index))
+        .field("magic", c.magic)
+        .field("major_version", c.major_version)
+        .field("minor_version", c.minor_version)
+        .field("access_flags", c.access_flags);
+
+    j.key("super");
+    if (c.super_class.get_index())
+        j.value(utf8_view(c, c.super_class.get(c).name_index));
+    else
+        j.null();
+
+    j.key("interfaces").begin_array();
+    for (auto i : c.interfaces)
+        j.value(utf8_view(c, i.get(c).name_index));
+    j.end_array();
+
+    j.key("constants").begin_array();
+    for (size_t i = 0; i < c.constant_pool.size(); i++)
+    {
+        if (std::holds_alternative<std::monostate>(c.constant_pool[i]))
+            continue;
+        j.begin_object().field("index", i + 1);
+        json_constant(j, c, c.constant_pool[i]);
+        j.end_object();
+    }
+    j.end_array();
+    out.maybe_flush();
+
+    json_members(j, c, "fields", c.fields, out);
+    json_members(j, c, "methods", c.methods, out);
+    json_attributes(j, c, c.attributes);
+    j.end_object();
+    out.buf().push_back('\n');
+    out.maybe_flush();
+}
+
+// quoted DOT id; escape_str leaves only printable ASCII, of which quotes and backslashes need escaping
+static std::string dot_quoted(std::string_view str)
+{
+    std::string out = "\"";
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + '"';
+}
+
+// control flow graphs of every method as one DOT digraph per class, a cluster per method and a node per basic block.
+// exception edges are dashed and labelled with the caught type
+static void dump_class_cfg(const class_file& c, output_sink& out)
+{
+    auto& buf = out.buf();
+    fmt::format_to(std::back_inserter(buf), "digraph {} {{\n    node [shape=box, fontname=monospace];\n",
+                   dot_quoted(dump_ref(c, c.this_class.get(c).name_index)));
+
+    for (size_t m = 0; m < c.methods.size(); m++)
+    {
+        const auto& method = c.methods[m];
+        for (const auto& attr : method.attributes)
+        {
+            const auto* code = std::get_if<code_attribute>(&resolve(c, attr));
+            if (!code)
+                continue;
+
+            auto graph = build_cfg(*code);
+            fmt::format_to(std::back_inserter(buf), "    subgraph cluster_{} {{\n        label={};\n", m,
+                           dot_quoted(dump_ref(c, method.name_index) + dump_ref(c, method.descriptor_index)));
+
+            std::string label;
+            size_t block = 0;
+            auto flush_block = [&] {
+                // mnemonics need no escaping, and the \l line breaks must stay as they are
+                fmt::format_to(std::back_inserter(buf), "        m{}_b{} [label=\"{}\"];\n", m, block, label);
+                label.clear();
+                block++;
+            };
+            for_each_instruction(c, *code, [&](size_t ip, const inst& i) {
+                if (ip == graph.block_ips[block + 1])
+                    flush_block();
+                label += fmt::format("{}: {}\\l", ip, opcode_table[i.opcode].name);
+            });
+            if (graph.size())
+                flush_block();
+
+            for (size_t b = 0; b < graph.size(); b++)
+            {
+                for (auto s : graph.successors(b))
+                    fmt::format_to(std::back_inserter(buf), "        m{}_b{} -> m{}_b{};\n", m, b, m, s);
+                for (auto e : graph.handlers(b))
+                {
+                    const auto& entry = code->exception_table[e.entry];
+                    std::string caught = entry.catch_type.has_value() ? dump_info(c, entry.catch_type.get(c)) : "<all>";
+                    fmt::format_to(std::back_inserter(buf), "        m{}_b{} -> m{}_b{} [style=dashed, label={}];\n", m, b, m, e.handler,
+                                   dot_quoted(caught));
+                }
+            }
+            buf.append(std::string_view("    }\n"));
+            out.maybe_flush();
+        }
+    }
+
+    buf.append(std::string_view("}\n"));
+    out.maybe_flush();
+}
+
+enum class output_format
+{
+    text,
+    binary,
+    jsonl,
+    dot,
+    // class records for the cross-reference index, see --index
+    xref,
+};
+
+// set once from the command line before any job runs
+static output_format format = output_format::text;
+
+static parse_options job_parse_options(parse_options options)
+{
+    options.compact_code = true;
+    // the binary dump copies stack maps and annotations verbatim, so they never need decoding, and the index only looks
+    // at the instructions
+    options.lazy_attributes = format == output_format::binary || format == output_format::xref;
+    return options;
+}
+
+static void begin_class(output_sink& out, const std::string& name)
+{
+    if (format == output_format::text)
+        out.append(fmt::format("dumping class {}\n", name));
+}
+
+static void render_class(const class_file& c, const std::string& name, output_sink& out, task_pool* pool)
+{
+    stats::scoped_phase timer(stats::phase::render);
+    if (format == output_format::text)
+        dump_class(c, out, pool);
+    else if (format == output_format::jsonl)
+        dump_class_json(c, name, out);
+    else if (format == output_format::dot)
+        dump_class_cfg(c, out);
+    else if (format == output_format::xref)
+    {
+        std::string record;
+        xref::write_class_refs(c, record);
+        out.append(record);
+    }
+    else
+    {
+        std::string record;
+        binary::write_record(c, name, record);
+        out.append(record);
+    }
+}
+
+// set from the command line, null unless --cache is given
+static std::unique_ptr<output_cache> cache;
+inline static constexpr uint64_t DEFAULT_CACHE_SIZE_MB = 1024;
+// bump whenever the rendering changes, so that cached and incrementally kept outputs of older builds are not reused
+inline static constexpr int OUTPUT_VERSION = 3;
+
+// everything besides the class itself that the rendered output depends on
+static std::string output_settings() { return fmt::format("{}:{}:{}:{}", OUTPUT_VERSION, (int)format, colors_enabled, show_stack); }
+
+// renders a class through the cache, a hit neither parses nor dumps it. `input` is the class file the output is keyed on
+static void render_cached(std::span<const uint8_t> input, const std::function<class_file()>& parse, const std::string& name,
+                          output_sink& out, task_pool* pool)
+{
+    if (!cache)
+    {
+        render_class(parse(), name, out, pool);
+        return;
+    }
+
+    // the text dump does not mention where the class came from, so identical classes share an entry
+    auto key = output_cache::key_for(input, fmt::format("{}:{}", output_settings(), format == output_format::text ? "" : name));
+    std::optional<std::string> hit;
+    {
+        stats::scoped_phase timer(stats::phase::read);
+        hit = cache->lookup(key);
+    }
+    if (hit)
+    {
+        stats::add(stats::counter::cache_hits);
+        out.append(*hit);
+        out.maybe_flush();
+        return;
+    }
+    stats::add(stats::counter::cache_misses);
+
+    // the entry has to be complete before it is stored, so a miss renders to memory rather than streaming
+    output_sink rendered;
+    render_class(parse(), name, rendered, pool);
+    {
+        stats::scoped_phase timer(stats::phase::write);
+        cache->store(key, rendered.view());
+    }
+    out.append(rendered.view());
+    out.maybe_flush();
+}
+
+static mapped_file read_file(const std::string& path)
+{
+    stats::scoped_phase timer(stats::phase::read);
+    mapped_file file(path);
+    stats::add(stats::counter::bytes_read, file.size());
+    return file;
+}
+
+struct dump_result
+{
+    output_sink out;
+    std::string err;
+    bool ok = true;
+};
+
+// a single class to dump, either a loose file or an archive entry. the pool, if any, may be used to split the class further
+using dump_job = std::function<void(dump_result&, task_pool*)>;
+
+template <typename F>
+static void capture_errors(dump_result& res, F&& f)
+{
+    try
+    {
+        f(res.out);
+    }
+    catch (class_parse_error& e)
+    {
+        res.err = fmt::format("bad class file: {}\n", e.what());
+        res.ok = false;
+    }
+    catch (std::runtime_error& e)
+    {
+        res.err = fmt::format("{}\n", e.what());
+        res.ok = false;
+    }
+    catch (std::bad_alloc&)
+    {
+        res.err = "out of memory\n";
+        res.ok = false;
+    }
+}
+
+static void add_archive_jobs(const std::string& path, std::vector<dump_job>& jobs)
+{
+    std::shared_ptr<zip_archive> jar;
+    dump_result res;
+    capture_errors(res, [&](output_sink&) {
+        stats::scoped_phase timer(stats::phase::read);
+        jar = std::make_shared<zip_archive>(path);
+    });
+    if (!res.ok)
+    {
+        jobs.push_back([err = res.err](dump_result& res, task_pool*) {
+            res.err = err;
+            res.ok = false;
+        });
+        return;
+    }
+
+    for (const auto& e : jar->entries())
+    {
+        if (e.is_directory() || !e.name.ends_with(".class"))
+            continue;
+
+        jobs.push_back([jar, &e, path](dump_result& res, task_pool* pool) {
+            capture_errors(res, [&](output_sink& out) {
+                std::string name = path + "!" + e.name;
+                begin_class(out, name);
+                std::vector<uint8_t> data;
+                {
+                    stats::scoped_phase timer(stats::phase::read);
+                    data = jar->read(e);
+                    stats::add(stats::counter::bytes_read, data.size());
+                }
+                render_cached(
+                    data, [&] { return parse_class(std::as_bytes(std::span(data)), e.name, job_parse_options({.borrow_input = true})); },
+                    name, out, pool);
+            });
+        });
+    }
+}
+
+static void add_file_job(const std::string& path, std::vector<dump_job>& jobs)
+{
+    jobs.push_back([path](dump_result& res, task_pool* pool) {
+        capture_errors(res, [&](output_sink& out) {
+            begin_class(out, path);
+            // input_owner keeps the mapping alive while the class borrows from it
+            auto file = std::make_shared<mapped_file>(read_file(path));
+            render_cached(
+                file->data(),
+                [&] { return parse_class(std::as_bytes(file->data()), job_parse_options({.borrow_input = true, .input_owner = file})); },
+                path, out, pool);
+        });
+    });
+}
+
+struct class_source
+{
+    // as found, including the root
+    std::string path;
+    // relative to the root, which is how the manifest and the mirrored output tree refer to it
+    std::string rel;
+    uint64_t size;
+    int64_t mtime_ns;
+};
+
+// .class files below each root, ordered by relative path. a relative path present under several roots is taken from
+// the first one, as on a class path
+static std::vector<class_source> find_classes(const std::vector<std::string>& roots)
+{
+    std::vector<class_source> found;
+    std::set<std::string> seen;
+    for (const auto& root : roots)
+    {
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(root, ec); !ec && it != std::filesystem::recursive_directory_iterator();
+             it.increment(ec))
+        {
+            const auto& path = it->path();
+            struct stat st;
+            if (!path.native().ends_with(".class") || ::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+                continue;
+
+            std::string rel = path.lexically_relative(root).generic_string();
+            // a newline cannot be recorded in the manifest
+            if (rel.find('\n') != std::string::npos || !seen.insert(rel).second)
+                continue;
+            found.push_back({path.string(), std::move(rel), (uint64_t)st.st_size, st.st_mtim.tv_sec * 1'000'000'000ll + st.st_mtim.tv_nsec});
+        }
+        if (ec)
+            throw std::runtime_error(fmt::format("unable to read directory {}: {}", root, ec.message()));
+    }
+
+    std::sort(found.begin(), found.end(), [](const class_source& a, const class_source& b) { return a.rel < b.rel; });
+    return found;
+}
+
+static void add_directory_jobs(const std::string& path, std::vector<dump_job>& jobs)
+{
+    std::vector<class_source> classes;
+    dump_result res;
+    capture_errors(res, [&](output_sink&) { classes = find_classes({path}); });
+    if (!res.ok)
+    {
+        jobs.push_back([err = res.err](dump_result& res, task_pool*) {
+            res.err = err;
+            res.ok = false;
+        });
+        return;
+    }
+
+    for (const auto& c : classes)
+        add_file_job(c.path, jobs);
+}
+
+// flushes what the job wrote to stdout, then reports its error if it failed
+static bool finish_result(dump_result& res, output_sink& out)
+{
+    out.flush();
+    if (!res.ok)
+        std::cerr << res.err;
+    return res.ok;
+}
+
+// runs the jobs and writes their outputs to stdout in job order, or passes them to `consume` instead if it is given
+static bool run_jobs(const std::vector<dump_job>& jobs, size_t threads, const std::function<void(std::string_view)>& consume = {})
+{
+    bool ok = true;
+    output_sink out(STDOUT_FILENO);
+    auto finish = [&ok, &out, &consume](dump_result& res) {
+        if (!consume)
+            out.append(res.out.view());
+        else if (res.ok)
+            consume(res.out.view());
+        ok &= finish_result(res, out);
+    };
+
+    if (threads <= 1)
+    {
+        // serial jobs stream straight to stdout, unless their output is consumed
+        for (const auto& job : jobs)
+        {
+            dump_result res = consume ? dump_result() : dump_result{output_sink(STDOUT_FILENO)};
+            job(res, nullptr);
+            if (consume)
+                finish(res);
+            else
+                ok &= finish_result(res, res.out);
+        }
+        return ok;
+    }
+
+    // parallel results are kept in memory until it is their turn, the writer window bounds how many
+    ordered_writer<dump_result> writer(std::max<size_t>(64, threads * 16), finish);
+    {
+        task_pool pool(threads);
+        for (size_t i = 0; i < jobs.size(); i++)
+        {
+            writer.reserve(i);
+            pool.submit([&writer, &jobs, &pool, i]() {
+                dump_result res;
+                jobs[i](res, &pool);
+                writer.complete(i, std::move(res));
+            });
+        }
+        writer.finish(jobs.size());
+    }
+    return ok;
+}
+
+// answers queries from an index written by --index: every matching member with the methods referencing it
+static void run_queries(const std::string& path, const std::vector<std::string>& queries)
+{
+    xref::index index(path);
+    auto escaped = [](std::string_view str) { return escape_str(std::span((const uint8_t*)str.data(), str.size())); };
+
+    output_sink out(STDOUT_FILENO);
+    output_consumer s(out, TAB_SIZE);
+    for (const auto& q : queries)
+    {
+        auto found = index.find(q);
+        if (found.empty())
+            s.w("{} ({}):", member(escaped(q)), constant(0));
+        for (size_t k : found)
+        {
+            auto postings = index.postings(k);
+            s.w("{} ({}):", member(escaped(index.key(k))), constant(postings.size()));
+            s.push();
+            for (const auto& p : postings)
+            {
+                const auto& site = index.site(p.site);
+                s.w("{}.{} {} {}", type(escaped(index.string(site.class_name))), member(escaped(index.string(site.method))),
+                    address_ref(p.ip), instruction(opcode_table[p.opcode].name));
+            }
+            s.pop();
+        }
+    }
+    out.flush();
+}
+
+inline static constexpr const char* MANIFEST_NAME = ".bytecode-decomp-manifest";
+
+static std::string output_suffix()
+{
+    switch (format)
+    {
+    case output_format::text:
+        return ".txt";
+    case output_format::binary:
+        return ".bin";
+    case output_format::jsonl:
+        return ".jsonl";
+    default:
+        return ".dot";
+    }
+}
+
+// a/B.class is rendered to a/B.txt, a/B.bin, a/B.jsonl or a/B.dot
+static std::string mirrored_path(const std::string& out_dir, const std::string& rel, std::string_view suffix)
+{
+    return fmt::format("{}/{}{}", out_dir, std::string_view(rel).substr(0, rel.size() - 6), suffix);
+}
+
+// removes an output, along with the directories that leaves empty
+static void remove_mirrored(const std::string& out_dir, const std::string& rel, std::string_view suffix)
+{
+    std::filesystem::path path = mirrored_path(out_dir, rel, suffix);
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    for (path = path.parent_path(); path.native().size() > out_dir.size(); path = path.parent_path())
+        if (!std::filesystem::remove(path, ec))
+            break;
+}
+
+// renders a class into its own file, which replaces the previous output only once it is complete
+static void render_to_file(const class_source& src, const mapped_file& file, const std::string& dest, task_pool* pool)
+{
+    std::filesystem::create_directories(std::filesystem::path(dest).parent_path());
+    std::string temp = fmt::format("{}.tmp-{}", dest, ::getpid());
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+        throw std::runtime_error("unable to create " + temp);
+
+    try
+    {
+        output_sink out(fd);
+        if (format == output_format::binary)
+        {
+            std::string header;
+            binary::write_stream_header(header);
+            out.append(header);
+        }
+        render_cached(
+            file.data(),
+            [&] { return parse_class(std::as_bytes(file.data()), src.path, job_parse_options({.borrow_input = true})); },
+            src.path, out, pool);
+        out.flush();
+    }
+    catch (...)
+    {
+        ::close(fd);
+        ::unlink(temp.c_str());
+        throw;
+    }
+
+    if (::close(fd) != 0 || ::rename(temp.c_str(), dest.c_str()) != 0)
+    {
+        ::unlink(temp.c_str());
+        throw std::runtime_error("unable to write " + dest);
+    }
+}
+
+// incremental mode: mirrors every class below the roots into out_dir, one output file per class. classes whose size
+// and mtime match the manifest are skipped without being read, touched ones are hashed and only re-rendered if their
+// content changed, and the outputs of classes that disappeared are removed
+static bool run_directories(const std::vector<std::string>& roots, const std::string& out_dir, size_t threads)
+{
+    timespec now;
+    ::clock_gettime(CLOCK_REALTIME, &now);
+    std::filesystem::create_directories(out_dir);
+
+    std::string manifest_path = out_dir + "/" + MANIFEST_NAME;
+    manifest previous = manifest::load(manifest_path);
+    manifest current;
+    current.suffix = output_suffix();
+    current.settings = output_settings();
+    current.started_ns = now.tv_sec * 1'000'000'000ll + now.tv_nsec;
+    bool reusable = previous.suffix == current.suffix && previous.settings == current.settings;
+
+    auto sources = find_classes(roots);
+    struct class_result
+    {
+        dump_result res;
+        std::optional<manifest::entry> entry;
+    };
+    std::vector<class_result> results(sources.size());
+
+    auto up_to_date = [&](const class_source& src, auto&& same) {
+        if (!reusable)
+            return false;
+        auto it = previous.entries.find(src.rel);
+        return it != previous.entries.end() && same(it->second) &&
+               ::access(mirrored_path(out_dir, src.rel, current.suffix).c_str(), F_OK) == 0;
+    };
+
+    std::vector<size_t> changed;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        const auto& src = sources[i];
+        if (up_to_date(src, [&](const manifest::entry& e) {
+                return e.size == src.size && e.mtime_ns == src.mtime_ns && e.mtime_ns < previous.started_ns;
+            }))
+            results[i].entry = previous.entries[src.rel];
+        else
+            changed.push_back(i);
+    }
+
+    auto update = [&](size_t i, task_pool* pool) {
+        const auto& src = sources[i];
+        auto& r = results[i];
+        capture_errors(r.res, [&](output_sink&) {
+            mapped_file file = read_file(src.path);
+            manifest::entry e{src.size, src.mtime_ns, xxh64(file.data())};
+            if (!up_to_date(src, [&](const manifest::entry& prev) { return prev.size == file.size() && prev.hash == e.hash; }))
+                render_to_file(src, file, mirrored_path(out_dir, src.rel, current.suffix), pool);
+            r.entry = e;
+        });
+        // whatever was rendered before no longer matches the class
+        if (!r.res.ok)
+            remove_mirrored(out_dir, src.rel, current.suffix);
+    };
+
+    if (threads <= 1)
+    {
+        for (size_t i : changed)
+            update(i, nullptr);
+    }
+    else
+    {
+        task_pool pool(threads);
+        task_group group(pool);
+        for (size_t i : changed)
+            group.run([&, i] { update(i, &pool); });
+        group.wait();
+    }
+
+    bool ok = true;
+    std::set<std::string_view> present;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        present.insert(sources[i].rel);
+        if (results[i].entry)
+            current.entries.emplace(sources[i].rel, *results[i].entry);
+        if (!results[i].res.ok)
+        {
+            std::cerr << results[i].res.err;
+            ok = false;
+        }
+    }
+
+    // outputs of classes that are gone, or all of them if they were written under another suffix
+    for (const auto& [rel, e] : previous.entries)
+        if (!present.contains(rel) || previous.suffix != current.suffix)
+            remove_mirrored(out_dir, rel, previous.suffix);
+
+    current.save(manifest_path);
+    return ok;
+}
+
+// phase times are summed over all threads, so they can add up to more than the wall time of a parallel run
+static void print_stats(bool json, std::chrono::steady_clock::duration wall)
+{
+    auto totals = stats::collect();
+    auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    uint64_t phase_total = 0;
+    for (auto n : totals.nanos)
+        phase_total += n;
+
+    std::vector<std::pair<std::string_view, uint64_t>> attributes(totals.attributes.begin(), totals.attributes.end());
+    std::stable_sort(attributes.begin(), attributes.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    fmt::memory_buffer buf;
+    auto out = std::back_inserter(buf);
+    if (json)
+    {
+        json_writer j(buf);
+        j.begin_object().field("wall_ms", ms(wall));
+        j.key("phases_ms").begin_object();
+        for (size_t i = 0; i < totals.nanos.size(); i++)
+            j.field(stats::PHASE_NAMES[i], ms(std::chrono::nanoseconds(totals.nanos[i])));
+        j.end_object();
+        j.key("counters").begin_object();
+        for (size_t i = 0; i < totals.counters.size(); i++)
+            j.field(stats::COUNTER_NAMES[i], totals.counters[i]);
+        j.end_object();
+        j.key("attributes").begin_object();
+        for (const auto& [name, n] : attributes)
+            j.field(name, n);
+        j.end_object().end_object();
+        buf.push_back('\n');
+    }
+    else
+    {
+        fmt::format_to(out, "{:<24}{:>12}{:>8}\n", "phase", "time (ms)", "share");
+        for (size_t i = 0; i < totals.nanos.size(); i++)
+            fmt::format_to(out, "{:<24}{:>12.3f}{:>7.1f}%\n", stats::PHASE_NAMES[i], ms(std::chrono::nanoseconds(totals.nanos[i])),
+                           phase_total ? 100.0 * totals.nanos[i] / phase_total : 0.0);
+        fmt::format_to(out, "{:<24}{:>12.3f}\n{:<24}{:>12.3f}\n\n", "all threads", ms(std::chrono::nanoseconds(phase_total)), "wall", ms(wall));
+
+        fmt::format_to(out, "{:<24}{:>12}\n", "counter", "value");
+        for (size_t i = 0; i < totals.counters.size(); i++)
+            fmt::format_to(out, "{:<24}{:>12}\n", stats::COUNTER_NAMES[i], totals.counters[i]);
+
+        if (!attributes.empty())
+            fmt::format_to(out, "\n{:<24}{:>12}\n", "attribute", "count");
+        for (const auto& [name, n] : attributes)
+            fmt::format_to(out, "{:<24}{:>12}\n", name, n);
+    }
+    std::cerr << std::string_view(buf.data(), buf.size());
+}
+
+// the benchmarks include this file for its renderers and bring their own main
+#ifndef BYTECODE_DECOMP_NO_MAIN
+static void usage(const char* name)
+{
+    std::cerr << fmt::format("usage: {} [-j jobs] [--color | --no-color] [--format=text|binary|jsonl | --cfg | --index=file] [--stack]\n"
+                             "       [--cache=dir [--cache-size=MB]] [--out-dir=dir] [--stats[=json]] [classfiles, jars or directories...]\n"
+                             "       {} [--color | --no-color] --query=file members...\n"
+                             "members are written as java/io/PrintStream.println(Ljava/lang/String;)V or java/lang/System.out, without\n"
+                             "the descriptor they match every overload or type\n",
+                             name, name);
+    exit(-1);
 }
 
 int main(int argc, char** argv)
 {
-    if (argc < 2)
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<std::string> inputs;
+    std::string out_dir;
+    std::string cache_dir;
+    std::string index_path;
+    std::string query_path;
+    std::optional<bool> stats_json;
+    uint64_t cache_size_mb = DEFAULT_CACHE_SIZE_MB;
+
+    // colours only make sense on a terminal, unless asked for explicitly
+    colors_enabled = ::isatty(STDOUT_FILENO) && !std::getenv("NO_COLOR");
+
+    for (int i = 1; i < argc; i++)
     {
-        std::cerr << fmt::format("usage: {} [classfiles...]", argv[0]);
-        exit(-1);
+        std::string arg = argv[i];
+        if (arg.starts_with("-j"))
+        {
+            std::string value = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            try
+            {
+                threads = parse_thread_count(value);
+            }
+            catch (std::exception&)
+            {
+                usage(argv[0]);
+            }
+        }
+        else if (arg == "--color")
+            colors_enabled = true;
+        else if (arg == "--no-color")
+            colors_enabled = false;
+        else if (arg == "--format=text")
+            format = output_format::text;
+        else if (arg == "--format=binary")
+            format = output_format::binary;
+        else if (arg == "--format=jsonl")
+            format = output_format::jsonl;
+        else if (arg == "--cfg")
+            format = output_format::dot;
+        else if (arg == "--stack")
+            show_stack = true;
+        else if (arg.starts_with("--index="))
+        {
+            index_path = arg.substr(8);
+            format = output_format::xref;
+        }
+        else if (arg.starts_with("--query="))
+            query_path = arg.substr(8);
+        else if (arg.starts_with("--cache="))
+            cache_dir = arg.substr(8);
+        else if (arg.starts_with("--cache-size="))
+        {
+            try
+            {
+                cache_size_mb = std::stoull(arg.substr(13));
+            }
+            catch (std::exception&)
+            {
+                usage(argv[0]);
+            }
+        }
+        else if (arg == "--stats" || arg == "--stats=json")
+            stats_json = arg == "--stats=json";
+        else if (arg.starts_with("--out-dir="))
+            out_dir = arg.substr(10);
+        else if (arg.starts_with("--"))
+            usage(argv[0]);
+        else
+            inputs.push_back(arg);
+    }
+
+    if (inputs.empty())
+        usage(argv[0]);
+
+    // the remaining arguments are members to look up rather than classes
+    if (!query_path.empty())
+    {
+        try
+        {
+            run_queries(query_path, inputs);
+        }
+        catch (std::runtime_error& e)
+        {
+            std::cerr << e.what() << "\n";
+            exit(-1);
+        }
+        return 0;
     }
 
-    bool fail = false;
-    for (size_t i = 1; i < argc; i++)
+    // an output tree can only mirror directories, and an index is a single file
+    bool directories = std::ranges::all_of(inputs, [](const std::string& i) { return std::filesystem::is_directory(i); });
+    if (!out_dir.empty() && (!index_path.empty() || !directories))
+        usage(argv[0]);
+
+    // jsonl passes some attributes on as their text rendering and DOT has no use for them either, so neither may carry
+    // escapes
+    if (format == output_format::jsonl || format == output_format::dot || format == output_format::xref)
+        colors_enabled = false;
+
+    if (!cache_dir.empty())
     {
         try
         {
-            std::cout << "dumping class " << argv[i] << '\n';
-            auto c = parse_class(argv[i]);
-            std::cout << dump_class_header(c) << dump_constant_pool(c) << dump_fields(c) << dump_methods(c) << dump_class_attributes(c);
+            cache = std::make_unique<output_cache>(cache_dir, cache_size_mb * 1024 * 1024);
         }
-        catch (class_parse_error& e)
+        catch (std::runtime_error& e)
         {
-            std::cerr << "bad class file: " << e.what() << '\n';
-            fail = true;
+            std::cerr << e.what() << "\n";
+            exit(-1);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    stats::enabled = stats_json.has_value();
+
+    bool ok;
+    if (!out_dir.empty())
+    {
+        try
+        {
+            ok = run_directories(inputs, out_dir, threads);
         }
         catch (std::runtime_error& e)
         {
-            std::cerr << e.what() << '\n';
-            fail = true;
+            std::cerr << e.what() << "\n";
+            ok = false;
         }
     }
+    else
+    {
+        std::vector<dump_job> jobs;
+        for (const auto& i : inputs)
+        {
+            if (std::filesystem::is_directory(i))
+                add_directory_jobs(i, jobs);
+            else if (is_archive_path(i))
+                add_archive_jobs(i, jobs);
+            else
+                add_file_job(i, jobs);
+        }
+
+        if (format == output_format::binary)
+        {
+            std::string header;
+            binary::write_stream_header(header);
+            output_sink out(STDOUT_FILENO);
+            out.append(header);
+            out.flush();
+        }
+
+        if (format == output_format::xref)
+        {
+            // classes are scanned in parallel, their records merged in input order so that the index comes out the same
+            // whatever the number of threads
+            xref::index_builder builder;
+            try
+            {
+                ok = run_jobs(jobs, threads, [&builder](std::string_view record) { builder.add(record); });
+                builder.write(index_path);
+            }
+            catch (std::runtime_error& e)
+            {
+                std::cerr << e.what() << "\n";
+                ok = false;
+            }
+        }
+        else
+            ok = run_jobs(jobs, threads);
+    }
 
-    if (fail)
+    if (cache)
+        cache->trim();
+    if (stats_json)
+        print_stats(*stats_json, std::chrono::steady_clock::now() - start);
+    if (!ok)
         exit(-1);
 }
+#endif
@@ -0,0 +1,762 @@
+// cSpell:ignore clazz classgen
+// generates synthetic class files of a controlled shape, for load tests and fuzzing corpora. the output only depends on
+// the seed and the size parameters, never on the platform or the number of threads. build with `./build.sh classgen`
+#include "../clazz/class_writer.h"
+#include "../clazz/clazz.h"
+#include "../task_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace clazz;
+using namespace clazz::annotations;
+using namespace clazz::stackmap;
+
+struct parameters
+{
+    uint64_t seed = 1;
+    size_t classes = 1;
+    // constants added on top of the ones the members refer to
+    size_t constants = 64;
+    size_t methods = 16;
+    // cases of the tableswitch and lookupswitch in every fourth method, 0 for none
+    size_t switch_size = 32;
+    // extra int locals of every method, all of them are listed in each stack map frame
+    size_t frame_depth = 4;
+    // nesting of annotations within annotation values
+    size_t annotation_depth = 2;
+};
+
+// splitmix64. the standard distributions are implementation defined, so everything random goes through this
+class rng
+{
+    uint64_t state;
+
+public:
+    explicit rng(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    // in [0, n)
+    uint64_t below(uint64_t n) { return n ? next() % n : 0; }
+    bool chance(unsigned percent) { return below(100) < percent; }
+};
+
+class class_generator
+{
+    const parameters& params;
+    rng random;
+    class_file clazz;
+    std::map<std::string, uint16_t, std::less<>> utf8s;
+
+    // constants that ldc and ldc2_w can load
+    struct loadable_constant
+    {
+        inst::operand_1_t ref;
+        uint16_t index;
+        // long and double take two stack slots
+        bool wide;
+    };
+    std::vector<loadable_constant> loadable;
+    fieldref_ref system_out;
+    methodref_ref println;
+    methodref_ref array_list_init;
+    interface_methodref_ref list_size;
+    class_ref array_list;
+    class_ref string_class;
+    class_ref int_matrix;
+    invoke_dynamic_ref make_runnable;
+
+    template <typename T>
+    std::pmr::vector<T> vec()
+    {
+        return std::pmr::vector<T>(clazz.arena.get());
+    }
+
+    uint16_t add(cp_info c)
+    {
+        // long and double take two slots
+        if (clazz.constant_pool.size() + 2 >= UINT16_MAX)
+            throw std::runtime_error("constant pool is full, use fewer constants or methods");
+        bool wide = std::holds_alternative<long_info>(c) || std::holds_alternative<double_info>(c);
+        clazz.constant_pool.push_back(c);
+        uint16_t index = clazz.constant_pool.size();
+        if (wide)
+            clazz.constant_pool.push_back(std::monostate{});
+        return index;
+    }
+
+    utf8_ref utf8(std::string_view str)
+    {
+        if (auto it = utf8s.find(str); it != utf8s.end())
+            return {clazz, it->second};
+        auto* copy = (uint8_t*)clazz.arena->allocate(std::max<size_t>(str.size(), 1), 1);
+        std::memcpy(copy, str.data(), str.size());
+        uint16_t index = add(utf8_info{{copy, str.size()}});
+        utf8s.emplace(str, index);
+        return {clazz, index};
+    }
+
+    class_ref class_constant(std::string_view name) { return {clazz, add(class_info{utf8(name)})}; }
+    string_ref string_constant(std::string_view str) { return {clazz, add(string_info{utf8(str)})}; }
+
+    name_and_type_ref name_and_type(std::string_view name, std::string_view descriptor)
+    {
+        return {clazz, add(name_and_type_info{utf8(name), utf8(descriptor)})};
+    }
+
+    template <typename T>
+    uint16_t member(std::string_view owner, std::string_view name, std::string_view descriptor)
+    {
+        return add(T{class_constant(owner), name_and_type(name, descriptor)});
+    }
+
+    template <typename T>
+    void add_attribute(std::pmr::vector<attribute>& attrs, T&& attr)
+    {
+        utf8(attribute_name<std::remove_cvref_t<T>>());
+        attrs.push_back(std::forward<T>(attr));
+    }
+
+    // printable ascii with the occasional escape, multi-byte character and encoded nul
+    std::string text(size_t min_len, size_t max_len)
+    {
+        static constexpr std::string_view SPECIAL[] = {"\n", "\t", "\"", "\\", "\xc3\xa9", "\xe2\x82\xac", "\xc0\x80"};
+        std::string s;
+        size_t len = min_len + random.below(max_len - min_len + 1);
+        while (s.size() < len)
+        {
+            if (random.chance(5))
+                s += SPECIAL[random.below(std::size(SPECIAL))];
+            else
+                s += (char)(' ' + random.below(95));
+        }
+        return s;
+    }
+
+    template <typename T>
+    void add_loadable(T ref)
+    {
+        loadable.push_back({ref, ref.get_index(), std::is_same_v<T, long_ref> || std::is_same_v<T, double_ref>});
+    }
+
+    void constant_ballast()
+    {
+        for (size_t i = 0; i < params.constants; i++)
+        {
+            switch (random.below(10))
+            {
+            case 0:
+            case 1:
+                add_loadable(string_constant(text(0, 40)));
+                break;
+            case 2:
+                add_loadable(integer_ref(clazz, add(integer_info{(int)random.next()})));
+                break;
+            case 3:
+                add_loadable(float_ref(clazz, add(float_info{(float)random.below(1 << 20) / 64})));
+                break;
+            case 4:
+                add_loadable(long_ref(clazz, add(long_info{(long)random.next()})));
+                break;
+            case 5:
+                add_loadable(double_ref(clazz, add(double_info{(double)random.next() / 3})));
+                break;
+            case 6:
+                add_loadable(class_constant(fmt::format("gen/ext/Type{}", random.below(1000))));
+                break;
+            case 7:
+                member<fieldref_info>(fmt::format("gen/ext/Owner{}", random.below(100)), fmt::format("f{}", i), "Ljava/lang/String;");
+                break;
+            case 8:
+                member<methodref_info>(fmt::format("gen/ext/Owner{}", random.below(100)), fmt::format("m{}", i), "(IJLjava/lang/Object;)[I");
+                break;
+            case 9:
+                add_loadable(method_type_ref(clazz, add(method_type_info{utf8("(Ljava/lang/String;)I")})));
+                break;
+            }
+        }
+    }
+
+    element_value element(size_t depth)
+    {
+        // nested values only while there is depth left
+        static constexpr char TAGS[] = {'B', 'C', 'D', 'F', 'I', 'J', 'S', 'Z', 's', 'e', 'c', '[', '@'};
+        char tag = TAGS[random.below(depth ? std::size(TAGS) : std::size(TAGS) - 2)];
+        element_value v{(uint8_t)tag};
+        switch (tag)
+        {
+        case 'D':
+            v.value = double_ref(clazz, add(double_info{(double)random.below(1000) / 8}));
+            break;
+        case 'F':
+            v.value = float_ref(clazz, add(float_info{(float)random.below(1000) / 8}));
+            break;
+        case 'J':
+            v.value = long_ref(clazz, add(long_info{(long)random.next()}));
+            break;
+        case 's':
+            v.value = utf8(text(0, 20));
+            break;
+        case 'e':
+            v.value = element_value::enum_const_value{utf8("Lgen/ann/Level;"), utf8(fmt::format("LEVEL{}", random.below(8)))};
+            break;
+        case 'c':
+            v.value = utf8(fmt::format("Lgen/ext/Type{};", random.below(1000)));
+            break;
+        case '[': {
+            // only the first value nests further, so the size stays linear in the depth
+            auto values = vec<element_value>();
+            for (size_t i = 0, n = random.below(4); i < n; i++)
+                values.push_back(element(i ? 0 : depth - 1));
+            v.value = std::move(values);
+            break;
+        }
+        case '@':
+            v.value = make_annotation(depth - 1);
+            break;
+        default:
+            v.value = integer_ref(clazz, add(integer_info{(int)random.below(128)}));
+            break;
+        }
+        return v;
+    }
+
+    // the first entry holds an annotation nested `depth` levels deep, so the size stays linear in the depth
+    annotation make_annotation(size_t depth)
+    {
+        annotation a{utf8(fmt::format("Lgen/ann/Marker{};", random.below(4))), vec<annotation::entry>()};
+        if (depth)
+        {
+            element_value nested{'@'};
+            nested.value = make_annotation(depth - 1);
+            a.entries.push_back({utf8("value"), std::move(nested)});
+        }
+        for (size_t i = 0, n = random.below(3); i < n; i++)
+            a.entries.push_back({utf8(fmt::format("e{}", i)), element(depth ? 1 : 0)});
+        return a;
+    }
+
+    std::pmr::vector<annotation> annotation_list()
+    {
+        auto list = vec<annotation>();
+        for (size_t i = 0, n = 1 + random.below(2); i < n; i++)
+            list.push_back(make_annotation(params.annotation_depth));
+        return list;
+    }
+
+    type_annotation make_type_annotation(uint8_t target_type, type_annotation::target_info_t target)
+    {
+        type_annotation a{target_type, std::move(target), {vec<type_path::entry>()}, utf8("Lgen/ann/TypeUse;"),
+                          vec<std::pair<utf8_ref, element_value>>()};
+        // array element, nested type, wildcard bound or type argument
+        for (size_t i = 0, n = random.below(3); i < n; i++)
+        {
+            uint8_t kind = random.below(4);
+            a.target_path.path.push_back({kind, (uint8_t)(kind == 3 ? random.below(3) : 0)});
+        }
+        if (params.annotation_depth)
+            a.entries.push_back({utf8("value"), element(params.annotation_depth)});
+        return a;
+    }
+
+    // a method body under construction; branch targets that need a stack map frame are collected on the way
+    struct body
+    {
+        std::pmr::vector<inst> code;
+        uint32_t ip = 0;
+        // ip of every frame and whether an int is on the stack there
+        std::map<uint32_t, bool> frames;
+        std::vector<uint32_t> lines;
+        std::vector<uint32_t> instanceofs;
+
+        void emit(inst i)
+        {
+            switch (opcode_table[i.opcode].kind)
+            {
+            case operand_kind::tableswitch:
+            case operand_kind::lookupswitch: {
+                size_t pad = (4 - ((ip + 1) & 0b11)) & 0b11;
+                if (const auto* t = std::get_if<tableswitch_data>(&i.special))
+                    i.inst_sz = 1 + pad + 12 + 4 * t->lut.size();
+                else
+                    i.inst_sz = 1 + pad + 8 + 8 * std::get<lookupswitch_data>(i.special).lut.size();
+                break;
+            }
+            case operand_kind::wide:
+                i.inst_sz = opcode_table[std::get<wide_data>(i.special).op].kind == operand_kind::iinc ? 6 : 4;
+                break;
+            default:
+                i.inst_sz = opcode_table[i.opcode].length;
+                break;
+            }
+            ip += i.inst_sz;
+            code.push_back(std::move(i));
+        }
+
+        void op(uint8_t opcode, inst::operand_1_t operand1 = {}, inst::operand_2_t operand2 = {})
+        {
+            emit({0, opcode, {}, operand1, operand2});
+        }
+
+        void local(uint8_t opcode, uint16_t index)
+        {
+            // xload and xstore have short forms for the first four locals
+            uint8_t short_base = opcode == 0x15 ? 0x1a : 0x3b;
+            if (index < 4)
+                op(short_base + index);
+            else if (index <= UINT8_MAX)
+                op(opcode, lvt_ref(index));
+            else
+                emit({0, 0xc4, wide_data{opcode}, lvt_ref(index)});
+        }
+
+        void iinc(uint16_t index, int delta)
+        {
+            if (index <= UINT8_MAX && delta >= INT8_MIN && delta <= INT8_MAX)
+                op(0x84, lvt_ref(index), delta);
+            else
+                emit({0, 0xc4, wide_data{0x84}, lvt_ref(index), delta});
+        }
+    };
+
+    void statement(body& b, uint16_t locals)
+    {
+        b.lines.push_back(b.ip);
+        uint16_t local = locals > 1 ? 1 + random.below(locals - 1) : 0;
+        switch (random.below(11))
+        {
+        case 0: // x = x + c
+            b.local(0x15, 0);
+            if (random.chance(50))
+                b.op(0x10, (int)(int8_t)random.next());
+            else
+                b.op(0x11, (int)(int16_t)random.next());
+            b.op(0x60);
+            b.local(0x36, 0);
+            break;
+        case 1: // System.out.println("...")
+            b.op(0xb2, system_out);
+            b.op(0x13, string_constant(text(0, 30)));
+            b.op(0xb6, println);
+            break;
+        case 2: { // load a constant and drop it
+            if (loadable.empty())
+                break;
+            const auto& c = loadable[random.below(loadable.size())];
+            b.op(c.wide ? 0x14 : c.index <= UINT8_MAX ? 0x12 : 0x13, c.ref);
+            b.op(c.wide ? 0x58 : 0x57);
+            break;
+        }
+        case 3:
+            b.iinc(local, (int)(int8_t)random.next());
+            break;
+        case 4:
+            b.iinc(local, (int)(int16_t)random.next());
+            break;
+        case 5: // new ArrayList().size()
+            b.op(0xbb, array_list);
+            b.op(0x59);
+            b.op(0xb7, array_list_init);
+            b.op(0xb9, list_size, 1);
+            b.local(0x36, local);
+            break;
+        case 6: // a lambda that is never run
+            b.op(0xba, make_runnable);
+            b.op(0x57);
+            break;
+        case 7: // new int[n].length and new int[2][3]
+            b.op(0x10, (int)random.below(100));
+            b.op(0xbc, primitive_type_ref(10));
+            b.op(0xbe);
+            b.local(0x36, local);
+            b.op(0x05);
+            b.op(0x06);
+            b.op(0xc5, int_matrix, 2);
+            b.op(0x57);
+            break;
+        case 8:
+            b.op(0x01);
+            b.instanceofs.push_back(b.ip);
+            b.op(0xc1, string_class);
+            b.op(0x57);
+            break;
+        case 9: // an int crosses a jump, so the frame at its target has a stack item
+            b.local(0x15, local);
+            b.op(0xa7, address_offset(3));
+            b.frames[b.ip] = true;
+            b.local(0x36, local);
+            break;
+        case 10: { // for (v = 0; v < n; v++)
+            b.op(0x03);
+            b.local(0x36, local);
+            uint32_t start = b.ip;
+            b.frames[start] = false;
+            b.iinc(local, 1);
+            b.local(0x15, local);
+            b.op(0x10, (int)random.below(100));
+            b.op(0xa1, address_offset((int32_t)start - (int32_t)b.ip));
+            break;
+        }
+        }
+    }
+
+    // every case jumps to the instruction after the switch
+    void switches(body& b)
+    {
+        size_t n = params.switch_size;
+        int32_t low = (int32_t)random.below(1000) - 500;
+
+        b.local(0x15, 0);
+        uint32_t ip = b.ip;
+        // the table has to be full size when emitted, since that determines where the switch ends
+        tableswitch_data table{0, low, (int32_t)(low + n - 1), vec<address_offset>()};
+        table.lut.assign(n, 0);
+        b.emit({0, 0xaa, std::move(table)});
+        auto& emitted = std::get<tableswitch_data>(b.code.back().special);
+        emitted.def = b.ip - ip;
+        std::ranges::fill(emitted.lut, address_offset(b.ip - ip));
+        b.frames[b.ip] = false;
+
+        // lookupswitch keys have to be sorted
+        b.local(0x15, 0);
+        ip = b.ip;
+        lookupswitch_data lookup{0, vec<std::pair<int32_t, address_offset>>()};
+        int32_t key = low;
+        for (size_t i = 0; i < n; i++)
+            lookup.lut.push_back({key += 1 + (int32_t)random.below(1000), 0});
+        b.emit({0, 0xab, std::move(lookup)});
+        auto& emitted_lookup = std::get<lookupswitch_data>(b.code.back().special);
+        emitted_lookup.def = b.ip - ip;
+        for (auto& [match, off] : emitted_lookup.lut)
+            off = b.ip - ip;
+        b.frames[b.ip] = false;
+    }
+
+    stack_map_table_attribute stack_map(const body& b, uint16_t locals)
+    {
+        stack_map_table_attribute attr{vec<stack_map_frame>()};
+        verification_type_info integer{VERIFICATION_INTEGER, 0};
+        // the compact frame types cannot describe more than three new locals
+        bool full = locals > 4;
+        int64_t previous = -1;
+        for (auto [ip, stack_item] : b.frames)
+        {
+            uint16_t delta = ip - previous - 1;
+            bool first = previous < 0;
+            previous = ip;
+
+            stack_map_frame frame{255};
+            if (full || (first && locals > 1 && stack_item))
+            {
+                stack_map_frame::full_frame f{delta, vec<verification_type_info>(), vec<verification_type_info>()};
+                f.locals.assign(locals, integer);
+                if (stack_item)
+                    f.stack.push_back(integer);
+                frame.data = std::move(f);
+            }
+            else if (first && locals > 1)
+            {
+                stack_map_frame::append_frame f{delta, vec<verification_type_info>()};
+                f.locals.assign(locals - 1, integer);
+                frame.frame_type = 251 + locals - 1;
+                frame.data = std::move(f);
+            }
+            else if (stack_item)
+            {
+                frame.frame_type = delta < 64 ? 64 + delta : 247;
+                if (delta < 64)
+                    frame.data = stack_map_frame::same_locals_1_stack_item_frame{integer};
+                else
+                    frame.data = stack_map_frame::same_locals_1_stack_item_frame_extended{delta, integer};
+            }
+            else
+            {
+                frame.frame_type = delta < 64 ? delta : 251;
+                if (delta < 64)
+                    frame.data = stack_map_frame::same_frame{};
+                else
+                    frame.data = stack_map_frame::same_frame_extended{delta};
+            }
+            attr.entries.push_back(std::move(frame));
+        }
+        return attr;
+    }
+
+    // static int mN(int x), with a local v1..vK per unit of frame depth
+    method_info method(size_t index)
+    {
+        method_info m{METHOD_ACC_PUBLIC | METHOD_ACC_STATIC, utf8(fmt::format("m{}", index)), utf8("(I)I"), vec<attribute>()};
+        uint16_t locals = 1 + params.frame_depth;
+
+        body b{vec<inst>()};
+        for (uint16_t i = 1; i < locals; i++)
+        {
+            b.op(0x03);
+            b.local(0x36, i);
+        }
+        if (params.switch_size && index % 4 == 0)
+            switches(b);
+        for (size_t i = 0, n = 8 + random.below(16); i < n; i++)
+            statement(b, locals);
+        b.local(0x15, 0);
+        b.op(0xac);
+
+        if (b.ip > UINT16_MAX)
+            throw std::runtime_error("method too large, use a smaller switch size");
+
+        code_attribute code{4, locals, b.ip, std::move(b.code), vec<code_attribute::exception_table_entry>(), vec<attribute>(), {}};
+
+        lineno_attribute lines{vec<lineno_attribute::lineno_entry>()};
+        for (size_t i = 0; i < b.lines.size(); i++)
+            lines.line_number_table.push_back({(uint16_t)b.lines[i], (uint16_t)(10 + i)});
+        add_attribute(code.attributes, std::move(lines));
+
+        lvt_attribute lvt{vec<lvt_attribute::lvt_entry>()};
+        for (uint16_t i = 0; i < locals; i++)
+            lvt.lvt.push_back({0, (uint16_t)b.ip, utf8(i ? fmt::format("v{}", i) : "x"), utf8("I"), i});
+        add_attribute(code.attributes, std::move(lvt));
+
+        if (!b.frames.empty())
+            add_attribute(code.attributes, stack_map(b, locals));
+
+        runtime_visible_type_annotations_attribute code_types{vec<type_annotation>()};
+        type_annotation::localvar_target target{vec<type_annotation::localvar_target::target_entry>()};
+        target.table.push_back({0, (uint16_t)b.ip, 0});
+        code_types.annotations.push_back(make_type_annotation(0x40, std::move(target)));
+        for (auto ip : b.instanceofs)
+            code_types.annotations.push_back(make_type_annotation(0x43, type_annotation::offset_target{(uint16_t)ip}));
+        add_attribute(code.attributes, std::move(code_types));
+
+        add_attribute(m.attributes, std::move(code));
+
+        bool throws = random.chance(30);
+        if (throws)
+        {
+            exceptions_attribute exceptions{vec<class_ref>()};
+            exceptions.exception_index_table.push_back(class_constant("java/io/IOException"));
+            add_attribute(m.attributes, std::move(exceptions));
+        }
+        if (random.chance(20))
+            add_attribute(m.attributes, signature_attribute{utf8("(I)I")});
+
+        add_attribute(m.attributes, runtime_visible_annotations_attribute{annotation_list()});
+        if (random.chance(50))
+            add_attribute(m.attributes, runtime_invisible_annotations_attribute{annotation_list()});
+
+        runtime_visible_parameter_annotations_attribute parameters{vec<std::pmr::vector<annotation>>()};
+        parameters.annotations.push_back(annotation_list());
+        add_attribute(m.attributes, std::move(parameters));
+
+        runtime_visible_type_annotations_attribute types{vec<type_annotation>()};
+        types.annotations.push_back(make_type_annotation(0x14, type_annotation::empty_target{}));
+        types.annotations.push_back(make_type_annotation(0x16, type_annotation::formal_parameter_target{0}));
+        if (throws)
+            types.annotations.push_back(make_type_annotation(0x17, type_annotation::throws_target{0}));
+        add_attribute(m.attributes, std::move(types));
+        return m;
+    }
+
+    field_info field(size_t index)
+    {
+        field_info f{FIELD_ACC_PRIVATE | FIELD_ACC_STATIC | FIELD_ACC_FINAL, utf8(fmt::format("F{}", index)), utf8("I"), vec<attribute>()};
+        add_attribute(f.attributes, constant_value_attribute{primitive_ref(clazz, add(integer_info{(int)random.next()}))});
+        if (random.chance(50))
+            add_attribute(f.attributes, runtime_visible_annotations_attribute{annotation_list()});
+        return f;
+    }
+
+    // the target of the lambdas that make_runnable creates
+    method_info lambda()
+    {
+        method_info m{METHOD_ACC_PRIVATE | METHOD_ACC_STATIC | METHOD_ACC_SYNTHETIC, utf8("lambda$0"), utf8("()V"), vec<attribute>()};
+        code_attribute code{0, 0, 1, vec<inst>(), vec<code_attribute::exception_table_entry>(), vec<attribute>(), {}};
+        code.code.push_back({1, 0xb1});
+        add_attribute(m.attributes, std::move(code));
+        return m;
+    }
+
+    bootstrap_methods_attribute bootstrap_methods(std::string_view name)
+    {
+        auto metafactory = member<methodref_info>("java/lang/invoke/LambdaMetafactory", "metafactory",
+                                                  "(Ljava/lang/invoke/MethodHandles$Lookup;Ljava/lang/String;Ljava/lang/invoke/MethodType;"
+                                                  "Ljava/lang/invoke/MethodType;Ljava/lang/invoke/MethodHandle;Ljava/lang/invoke/MethodType;)"
+                                                  "Ljava/lang/invoke/CallSite;");
+        auto target = member<methodref_info>(name, "lambda$0", "()V");
+        auto signature = add(method_type_info{utf8("()V")});
+
+        bootstrap_methods_attribute attr{vec<bootstrap_methods_attribute::bootstrap_methods_entry>()};
+        bootstrap_methods_attribute::bootstrap_methods_entry entry{method_handle_ref(clazz, add(method_handle_info{6, member_ref(clazz, metafactory)})),
+                                                                   vec<any_cp_ref>()};
+        entry.bootstrap_arguments.push_back(any_cp_ref(clazz, signature));
+        entry.bootstrap_arguments.push_back(any_cp_ref(clazz, add(method_handle_info{6, member_ref(clazz, target)})));
+        entry.bootstrap_arguments.push_back(any_cp_ref(clazz, signature));
+        attr.bootstrap_methods.push_back(std::move(entry));
+        return attr;
+    }
+
+public:
+    class_generator(const parameters& params, uint64_t seed)
+        : params(params), random(seed), clazz(std::make_shared<std::pmr::monotonic_buffer_resource>())
+    {
+    }
+
+    class_file generate(std::string_view name)
+    {
+        clazz.magic = 0xcafebabe;
+        clazz.major_version = 52;
+        clazz.access_flags = CL_ACC_PUBLIC | CL_ACC_SUPER;
+        clazz.this_class = class_constant(name);
+        clazz.super_class = class_constant("java/lang/Object");
+        clazz.interfaces.push_back(class_constant("java/io/Serializable"));
+
+        system_out = {clazz, member<fieldref_info>("java/lang/System", "out", "Ljava/io/PrintStream;")};
+        println = {clazz, member<methodref_info>("java/io/PrintStream", "println", "(Ljava/lang/String;)V")};
+        array_list = class_constant("java/util/ArrayList");
+        array_list_init = {clazz, member<methodref_info>("java/util/ArrayList", "<init>", "()V")};
+        list_size = {clazz, member<interface_methodref_info>("java/util/List", "size", "()I")};
+        string_class = class_constant("java/lang/String");
+        int_matrix = class_constant("[[I");
+        make_runnable = {clazz, add(invoke_dynamic_info{0, name_and_type("run", "()Ljava/lang/Runnable;")})};
+
+        constant_ballast();
+
+        for (size_t i = 0, n = params.methods / 4 + 1; i < n; i++)
+            clazz.fields.push_back(field(i));
+        for (size_t i = 0; i < params.methods; i++)
+            clazz.methods.push_back(method(i));
+        clazz.methods.push_back(lambda());
+
+        std::string_view simple = name.substr(name.rfind('/') + 1);
+        add_attribute(clazz.attributes, source_file_attribute{utf8(fmt::format("{}.java", simple))});
+        clazz.bootstrap_index = clazz.attributes.size();
+        add_attribute(clazz.attributes, bootstrap_methods(name));
+        add_attribute(clazz.attributes, runtime_visible_annotations_attribute{annotation_list()});
+
+        runtime_invisible_type_annotations_attribute types{vec<type_annotation>()};
+        types.annotations.push_back(make_type_annotation(0x10, type_annotation::supertype_target{UINT16_MAX}));
+        types.annotations.push_back(make_type_annotation(0x10, type_annotation::supertype_target{0}));
+        add_attribute(clazz.attributes, std::move(types));
+        return std::move(clazz);
+    }
+};
+
+static std::string class_name(size_t index) { return fmt::format("gen/p{:02}/Class{:06}", index % 32, index); }
+
+// parsing the bytes and writing them again has to give the same bytes, in both code representations
+static void verify(const std::string& name, const std::vector<uint8_t>& data)
+{
+    for (bool compact : {false, true})
+    {
+        auto parsed = parse_class(std::as_bytes(std::span(data)), name, parse_options{.borrow_input = true, .compact_code = compact});
+        if (write_class(parsed) != data)
+            throw std::runtime_error(name + ": does not round trip");
+    }
+}
+
+static void usage(const char* name)
+{
+    std::cerr << fmt::format("usage: {} [-j jobs] [--seed=N] [--classes=N] [--constants=N] [--methods=N] [--switch-size=N]\n"
+                             "       [--frame-depth=N] [--annotation-depth=N] [--verify] out_dir\n",
+                             name);
+    exit(-1);
+}
+
+int main(int argc, char** argv)
+{
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    parameters params;
+    bool check = false;
+    std::string out_dir;
+
+    const std::pair<std::string_view, size_t*> SIZES[] = {
+        {"--classes=", &params.classes},
+        {"--constants=", &params.constants},
+        {"--methods=", &params.methods},
+        {"--switch-size=", &params.switch_size},
+        {"--frame-depth=", &params.frame_depth},
+        {"--annotation-depth=", &params.annotation_depth},
+    };
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            auto size = std::ranges::find_if(SIZES, [&](const auto& s) { return arg.starts_with(s.first); });
+            if (size != std::end(SIZES))
+                *size->second = std::stoull(arg.substr(size->first.size()));
+            else if (arg.starts_with("--seed="))
+                params.seed = std::stoull(arg.substr(7));
+            else if (arg.starts_with("-j"))
+                threads = parse_thread_count(arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : ""));
+            else if (arg == "--verify")
+                check = true;
+            else if (arg.starts_with("-") || !out_dir.empty())
+                usage(argv[0]);
+            else
+                out_dir = arg;
+        }
+        catch (std::exception&)
+        {
+            usage(argv[0]);
+        }
+    }
+
+    // every local is listed in each frame, whose locals count is a u16
+    if (out_dir.empty() || params.frame_depth >= UINT16_MAX)
+        usage(argv[0]);
+
+    std::atomic_uint64_t total_bytes = 0;
+    std::atomic_bool failed = false;
+    {
+        task_pool pool(std::max<size_t>(threads, 1));
+        task_group group(pool);
+        for (size_t i = 0; i < params.classes; i++)
+        {
+            group.run([&, i] {
+                try
+                {
+                    // every class has its own stream, so the output does not depend on the order they are made in
+                    std::string name = class_name(i);
+                    auto data = write_class(class_generator(params, params.seed ^ (i * 0xd1b54a32d192ed03)).generate(name));
+                    if (check)
+                        verify(name, data);
+
+                    auto path = std::filesystem::path(out_dir) / (name + ".class");
+                    std::filesystem::create_directories(path.parent_path());
+                    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                    if (!out.write((const char*)data.data(), data.size()))
+                        throw std::runtime_error("unable to write " + path.string());
+                    total_bytes += data.size();
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << fmt::format("{}: {}\n", class_name(i), e.what());
+                    failed = true;
+                }
+            });
+        }
+        group.wait();
+    }
+
+    std::cerr << fmt::format("{} classes, {} bytes\n", params.classes, total_bytes.load());
+    return failed ? 1 : 0;
+}
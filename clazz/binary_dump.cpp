@@ -0,0 +1,354 @@
+// cSpell:ignore clazz
+#include "binary_dump.h"
+#include <bit>
+#include <cstring>
+#include <initializer_list>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace clazz::binary
+{
+    static_assert(std::endian::native == std::endian::little, "the binary dump is written in host byte order");
+
+    // appends one record to `out`; offsets are relative to where the record started
+    class record_writer
+    {
+        std::string& out;
+        size_t base;
+
+    public:
+        inline record_writer(std::string& out) : out(out), base(out.size()) {}
+
+        inline uint32_t pos() const { return out.size() - base; }
+
+        inline void align() { out.resize(base + ((pos() + 7) & ~7u), '\0'); }
+
+        inline uint32_t put_bytes(const void* data, size_t n)
+        {
+            uint32_t at = pos();
+            out.append((const char*)data, n);
+            return at;
+        }
+
+        template <typename T>
+        uint32_t put(const T& v)
+        {
+            return put_bytes(&v, sizeof(T));
+        }
+
+        template <typename T>
+        uint32_t put_array(std::span<const T> v)
+        {
+            align();
+            return put_bytes(v.data(), v.size_bytes());
+        }
+
+        // zero-filled space for `count` T that is filled in later with patch()
+        template <typename T>
+        uint32_t reserve(size_t count)
+        {
+            align();
+            uint32_t at = pos();
+            out.resize(out.size() + sizeof(T) * count, '\0');
+            return at;
+        }
+
+        template <typename T>
+        void patch(uint32_t at, const T& v)
+        {
+            std::memcpy(out.data() + base + at, &v, sizeof(T));
+        }
+    };
+
+    class class_writer
+    {
+        const class_file& clazz;
+        record_writer w;
+        attribute_name_indices name_index;
+
+        void write_table(attribute_entry& e, uint32_t columns, std::span<const uint16_t> data)
+        {
+            e.encoding = attribute_encoding::u16_table;
+            e.offset = w.put(u16_table{columns, (uint32_t)(data.size() / columns)});
+            w.put_bytes(data.data(), data.size_bytes());
+        }
+
+        void write_table(attribute_entry& e, uint32_t columns, std::initializer_list<uint16_t> data)
+        {
+            write_table(e, columns, std::span(data.begin(), data.size()));
+        }
+
+        void write_code(attribute_entry& e, const code_attribute& attr)
+        {
+            e.encoding = attribute_encoding::code;
+
+            const compact_code* code = &attr.compact;
+            compact_code converted;
+            if (attr.compact.empty() && !attr.code.empty())
+            {
+                size_t ip = 0;
+                for (const auto& i : attr.code)
+                {
+                    append_compact(converted, i, ip);
+                    ip += i.inst_sz;
+                }
+                converted.ips.push_back(attr.max_ip);
+                code = &converted;
+            }
+
+            code_header h{attr.max_stack, attr.max_locals, (uint32_t)attr.max_ip, (uint32_t)code->size(), (uint32_t)code->side.size(),
+                          (uint32_t)attr.exception_table.size(), (uint32_t)attr.attributes.size()};
+            e.offset = w.reserve<code_header>(1);
+
+            h.opcodes = w.put_array(std::span<const uint8_t>(code->opcodes));
+            if (code->ips.empty())
+                h.ips = w.put_array(std::span<const uint32_t>(&h.code_length, 1));
+            else
+                h.ips = w.put_array(std::span<const uint32_t>(code->ips));
+            h.operands = w.put_array(std::span<const int32_t>(code->operands));
+            h.operands2 = w.put_array(std::span<const int16_t>(code->operands2));
+            h.side = w.put_array(std::span<const int32_t>(code->side));
+
+            h.exceptions = w.reserve<exception_entry>(attr.exception_table.size());
+            for (size_t i = 0; i < attr.exception_table.size(); i++)
+            {
+                const auto& ex = attr.exception_table[i];
+                w.patch(h.exceptions + i * sizeof(exception_entry),
+                        exception_entry{ex.start_pc.ip, ex.end_pc.ip, ex.handler_pc.ip, ex.catch_type.get_index()});
+            }
+
+            h.attributes = write_attributes(attr.attributes);
+            w.patch(e.offset, h);
+        }
+
+        void write_attribute(attribute_entry& e, const attribute& attr)
+        {
+            // Code is always written decoded, the other deferred attributes keep their class file encoding
+            const attribute* decoded = &attr;
+            if (const auto* lazy = std::get_if<lazy_attribute>(&attr))
+            {
+                e.name = lazy->attribute_name_index.get_index();
+                if (e.name != name_index("Code"))
+                {
+                    e.encoding = attribute_encoding::raw;
+                    e.offset = w.put_bytes(lazy->bytes.data(), lazy->bytes.size());
+                    return;
+                }
+                decoded = &resolve(clazz, attr);
+            }
+
+            std::visit(
+                [&]<typename T>(const T& a) {
+                    std::vector<uint16_t> rows;
+                    if constexpr (std::is_same_v<T, attribute_info>)
+                    {
+                        e.name = a.attribute_name_index.get_index();
+                        e.encoding = attribute_encoding::raw;
+                        e.offset = w.put_bytes(a.buffer.data(), a.buffer.size());
+                        return;
+                    }
+                    else if constexpr (std::is_same_v<T, lazy_attribute>)
+                        return; // resolved above
+                    else
+                        e.name = name_index(attribute_name<T>());
+
+                    if constexpr (std::is_same_v<T, code_attribute>)
+                        write_code(e, a);
+                    else if constexpr (std::is_same_v<T, signature_attribute>)
+                        write_table(e, 1, {a.signature_index.get_index()});
+                    else if constexpr (std::is_same_v<T, source_file_attribute>)
+                        write_table(e, 1, {a.sourcefile_index.get_index()});
+                    else if constexpr (std::is_same_v<T, constant_value_attribute>)
+                        write_table(e, 1, {a.constantvalue_index.get_index()});
+                    else if constexpr (std::is_same_v<T, nest_host_attribute>)
+                        write_table(e, 1, {a.host_class_index.get_index()});
+                    else if constexpr (std::is_same_v<T, enclosing_method_attribute>)
+                        write_table(e, 2, {a.class_index.get_index(), a.method_index.get_index()});
+                    else if constexpr (std::is_same_v<T, exceptions_attribute> || std::is_same_v<T, nest_members_attribute>)
+                    {
+                        const auto& classes = [&]() -> const auto& {
+                            if constexpr (std::is_same_v<T, exceptions_attribute>)
+                                return a.exception_index_table;
+                            else
+                                return a.classes;
+                        }();
+                        for (auto i : classes)
+                            rows.push_back(i.get_index());
+                        write_table(e, 1, rows);
+                    }
+                    else if constexpr (std::is_same_v<T, lineno_attribute>)
+                    {
+                        for (const auto& i : a.line_number_table)
+                            rows.insert(rows.end(), {i.start_pc.ip, i.line_number});
+                        write_table(e, 2, rows);
+                    }
+                    else if constexpr (std::is_same_v<T, lvt_attribute>)
+                    {
+                        for (const auto& i : a.lvt)
+                            rows.insert(rows.end(), {i.start_pc.ip, i.length, i.name_index.get_index(), i.descriptor_index.get_index(), i.index.index});
+                        write_table(e, 5, rows);
+                    }
+                    else if constexpr (std::is_same_v<T, lvt_type_attribute>)
+                    {
+                        for (const auto& i : a.lvt)
+                            rows.insert(rows.end(), {i.start_pc.ip, i.length, i.name_index.get_index(), i.signature_index.get_index(), i.index.index});
+                        write_table(e, 5, rows);
+                    }
+                    else if constexpr (std::is_same_v<T, inner_class_attribute>)
+                    {
+                        for (const auto& i : a.inner_classes)
+                            rows.insert(rows.end(), {i.inner_class_info_index.get_index(), i.outer_class_info_index.get_index(),
+                                                     i.inner_name_index.get_index(), i.inner_class_access_flags});
+                        write_table(e, 4, rows);
+                    }
+                    else if constexpr (std::is_same_v<T, bootstrap_methods_attribute>)
+                    {
+                        for (const auto& i : a.bootstrap_methods)
+                        {
+                            rows.insert(rows.end(), {i.bootstrap_method_ref.get_index(), (uint16_t)i.bootstrap_arguments.size()});
+                            for (auto arg : i.bootstrap_arguments)
+                                rows.push_back(arg.get_index());
+                        }
+                        write_table(e, 1, rows);
+                    }
+                    else
+                    {
+                        e.encoding = attribute_encoding::omitted;
+                        e.offset = w.pos();
+                    }
+                },
+                *decoded);
+        }
+
+        uint32_t write_attributes(const std::pmr::vector<attribute>& attrs)
+        {
+            uint32_t table = w.reserve<attribute_entry>(attrs.size());
+            for (size_t i = 0; i < attrs.size(); i++)
+            {
+                attribute_entry e{};
+                w.align();
+                write_attribute(e, attrs[i]);
+                e.size = w.pos() - e.offset;
+                w.patch(table + i * sizeof(attribute_entry), e);
+            }
+            return table;
+        }
+
+        template <typename T>
+        uint32_t write_members(const std::pmr::vector<T>& members)
+        {
+            uint32_t table = w.reserve<member_entry>(members.size());
+            for (size_t i = 0; i < members.size(); i++)
+            {
+                const auto& m = members[i];
+                member_entry e{m.access_flags, m.name_index.get_index(), m.descriptor_index.get_index(), 0, 0,
+                               (uint32_t)m.attributes.size()};
+                e.attributes = write_attributes(m.attributes);
+                w.patch(table + i * sizeof(member_entry), e);
+            }
+            return table;
+        }
+
+        void write_constant_pool(record_header& h)
+        {
+            std::vector<cp_entry> entries(clazz.constant_pool.size() + 1);
+
+            // utf8 bytes go first so that their offsets are known when the entries are written
+            h.strings = w.reserve<char>(0);
+            for (size_t i = 0; i < clazz.constant_pool.size(); i++)
+            {
+                if (const auto* utf8 = std::get_if<utf8_info>(&clazz.constant_pool[i]))
+                {
+                    uint32_t at = w.put_bytes(utf8->bytes.data(), utf8->bytes.size());
+                    entries[i + 1].value = at | ((uint64_t)utf8->bytes.size() << 32);
+                }
+            }
+
+            for (size_t i = 0; i < clazz.constant_pool.size(); i++)
+            {
+                cp_entry& e = entries[i + 1];
+                std::visit(
+                    [&]<typename T>(const T& info) {
+                        if constexpr (std::is_same_v<T, utf8_info>)
+                            e.tag = 1;
+                        else if constexpr (std::is_same_v<T, integer_info>)
+                            e.tag = 3, e.value = std::bit_cast<uint32_t>(info.value);
+                        else if constexpr (std::is_same_v<T, float_info>)
+                            e.tag = 4, e.value = std::bit_cast<uint32_t>(info.value);
+                        else if constexpr (std::is_same_v<T, long_info>)
+                            e.tag = 5, e.value = (uint64_t)info.value;
+                        else if constexpr (std::is_same_v<T, double_info>)
+                            e.tag = 6, e.value = std::bit_cast<uint64_t>(info.value);
+                        else if constexpr (std::is_same_v<T, class_info>)
+                            e.tag = 7, e.a = info.name_index.get_index();
+                        else if constexpr (std::is_same_v<T, string_info>)
+                            e.tag = 8, e.a = info.string_index.get_index();
+                        else if constexpr (std::is_same_v<T, fieldref_info> || std::is_same_v<T, methodref_info> ||
+                                           std::is_same_v<T, interface_methodref_info>)
+                        {
+                            e.tag = std::is_same_v<T, fieldref_info> ? 9 : std::is_same_v<T, methodref_info> ? 10 : 11;
+                            e.a = info.class_index.get_index();
+                            e.b = info.name_and_type_index.get_index();
+                        }
+                        else if constexpr (std::is_same_v<T, name_and_type_info>)
+                            e.tag = 12, e.a = info.name_index.get_index(), e.b = info.descriptor_index.get_index();
+                        else if constexpr (std::is_same_v<T, method_handle_info>)
+                            e.tag = 15, e.kind = info.reference_kind, e.a = info.reference_index.get_index();
+                        else if constexpr (std::is_same_v<T, method_type_info>)
+                            e.tag = 16, e.a = info.descriptor_index.get_index();
+                        else if constexpr (std::is_same_v<T, invoke_dynamic_info>)
+                            e.tag = 18, e.a = info.bootstrap_method_attr_index, e.b = info.name_and_type_index.get_index();
+                    },
+                    clazz.constant_pool[i]);
+            }
+
+            h.constant_count = entries.size();
+            h.constant_pool = w.put_array(std::span<const cp_entry>(entries));
+        }
+
+    public:
+        inline class_writer(const class_file& clazz, std::string& out) : clazz(clazz), w(out), name_index(clazz) {}
+
+        void write(std::string_view source_name)
+        {
+            record_header h{0, clazz.minor_version, clazz.major_version, clazz.access_flags, clazz.this_class.get_index(),
+                            clazz.super_class.get_index()};
+            w.reserve<record_header>(1);
+
+            h.source_name = w.put((uint32_t)source_name.size());
+            w.put_bytes(source_name.data(), source_name.size());
+
+            write_constant_pool(h);
+
+            std::vector<uint16_t> interfaces;
+            for (auto i : clazz.interfaces)
+                interfaces.push_back(i.get_index());
+            h.interface_count = interfaces.size();
+            h.interfaces = w.put_array(std::span<const uint16_t>(interfaces));
+
+            h.field_count = clazz.fields.size();
+            h.fields = write_members(clazz.fields);
+            h.method_count = clazz.methods.size();
+            h.methods = write_members(clazz.methods);
+            h.attribute_count = clazz.attributes.size();
+            h.attributes = write_attributes(clazz.attributes);
+
+            w.align();
+            h.size = w.pos();
+            w.patch(0, h);
+        }
+    };
+
+    void write_stream_header(std::string& out)
+    {
+        stream_header h{{MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3]}, VERSION, 0};
+        out.append((const char*)&h, sizeof(h));
+    }
+
+    void write_record(const class_file& clazz, std::string_view source_name, std::string& out)
+    {
+        class_writer(clazz, out).write(source_name);
+    }
+} // namespace clazz::binary
@@ -0,0 +1,149 @@
+// cSpell:ignore clazz
+#pragma once
+#include "clazz.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// compact binary form of parsed classes, meant to be mmap'd and read in place by indexers.
+//
+// a stream is a stream_header followed by one record per class. every record starts 8-byte aligned with a
+// record_header, all offsets are relative to the start of their record and all integers are little-endian. arrays
+// referenced from a header are laid out back to back inside the record, so a record can be skipped using its size
+// alone. readers should reject a stream whose version they do not know
+namespace clazz::binary
+{
+    inline constexpr char MAGIC[4] = {'C', 'L', 'Z', 'B'};
+    inline constexpr uint16_t VERSION = 1;
+
+    struct stream_header
+    {
+        char magic[4];
+        uint16_t version;
+        uint16_t reserved;
+    };
+
+    struct record_header
+    {
+        // of the whole record, including this header and trailing padding
+        uint32_t size;
+        uint16_t minor_version;
+        uint16_t major_version;
+        uint16_t access_flags;
+        uint16_t this_class;
+        uint16_t super_class;
+        uint16_t reserved;
+        // string: u32 length followed by the bytes
+        uint32_t source_name;
+        // cp_entry[constant_count], entry 0 is unused so that constant pool indices can be used directly
+        uint32_t constant_pool;
+        uint32_t constant_count;
+        // u16[interface_count] of class constants
+        uint32_t interfaces;
+        uint32_t interface_count;
+        // member_entry[field_count] and member_entry[method_count]
+        uint32_t fields;
+        uint32_t field_count;
+        uint32_t methods;
+        uint32_t method_count;
+        // attribute_entry[attribute_count]
+        uint32_t attributes;
+        uint32_t attribute_count;
+        // utf8 constants, referenced from the constant pool
+        uint32_t strings;
+    };
+
+    // tag is the class file constant tag (0 for unused slots). for utf8, value holds the offset of the bytes in the
+    // low 32 bits and their length in the high 32 bits; integer, float, long and double hold their raw bits in value.
+    // references use a and b in class file order: class, string and method_type use a; fieldref, methodref,
+    // interface_methodref and name_and_type use a and b; method_handle has its kind in `kind` and the reference in a;
+    // invoke_dynamic has the bootstrap method index in a and the name_and_type in b
+    struct cp_entry
+    {
+        uint8_t tag;
+        uint8_t kind;
+        uint16_t a;
+        uint16_t b;
+        uint16_t reserved;
+        uint64_t value;
+    };
+
+    struct member_entry
+    {
+        uint16_t access_flags;
+        uint16_t name;
+        uint16_t descriptor;
+        uint16_t reserved;
+        uint32_t attributes;
+        uint32_t attribute_count;
+    };
+
+    enum class attribute_encoding : uint16_t
+    {
+        // the attribute body exactly as in the class file
+        raw,
+        // code_header
+        code,
+        // u16_table
+        u16_table,
+        // the attribute was decoded eagerly into a form that has no binary encoding (stack map frames,
+        // annotations); parse with parse_options::lazy_attributes to keep their bytes. the payload is empty
+        omitted,
+    };
+
+    struct attribute_entry
+    {
+        uint16_t name;
+        attribute_encoding encoding;
+        uint32_t offset;
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    // followed by rows * columns u16, row by row. used for the attributes that are just constant pool indices and
+    // small integers, in class file field order: Signature, SourceFile, ConstantValue, NestHost (1 x 1), Exceptions,
+    // NestMembers (n x 1), LineNumberTable (n x 2), LocalVariableTable, LocalVariableTypeTable (n x 5), InnerClasses
+    // (n x 4), EnclosingMethod (1 x 2). BootstrapMethods is a single column holding, per method, the method handle,
+    // the argument count and the arguments
+    struct u16_table
+    {
+        uint32_t columns;
+        uint32_t rows;
+    };
+
+    // instructions in the struct-of-arrays form of compact_code: opcodes (u8[instruction_count]), ips
+    // (u32[instruction_count + 1]), operands (i32[instruction_count]), operands2 (i16[instruction_count]) and side
+    // (i32[side_count]); exceptions is exception_entry[exception_count]
+    struct code_header
+    {
+        uint16_t max_stack;
+        uint16_t max_locals;
+        uint32_t code_length;
+        uint32_t instruction_count;
+        uint32_t side_count;
+        uint32_t exception_count;
+        uint32_t attribute_count;
+        uint32_t opcodes;
+        uint32_t ips;
+        uint32_t operands;
+        uint32_t operands2;
+        uint32_t side;
+        uint32_t exceptions;
+        uint32_t attributes;
+        uint32_t reserved;
+    };
+
+    struct exception_entry
+    {
+        uint16_t start_pc;
+        uint16_t end_pc;
+        uint16_t handler_pc;
+        uint16_t catch_type;
+    };
+
+    void write_stream_header(std::string& out);
+
+    // appends the record of one class. lazy attributes are resolved as needed, so this must not race with other
+    // resolves of a class that shares a caller-provided arena
+    void write_record(const class_file& clazz, std::string_view source_name, std::string& out);
+} // namespace clazz::binary
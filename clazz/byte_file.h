@@ -0,0 +1,104 @@
+// cSpell:ignore clazz
+#pragma once
+#include "clazz.h"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace clazz
+{
+    inline uint16_t load_u16(const uint8_t* p)
+    {
+        uint16_t n;
+        std::memcpy(&n, p, 2);
+        return __builtin_bswap16(n);
+    }
+
+    inline uint32_t load_u32(const uint8_t* p)
+    {
+        uint32_t n;
+        std::memcpy(&n, p, 4);
+        return __builtin_bswap32(n);
+    }
+
+    inline uint64_t load_u64(const uint8_t* p)
+    {
+        uint64_t n;
+        std::memcpy(&n, p, 8);
+        return __builtin_bswap64(n);
+    }
+
+    inline int32_t load_i32(const uint8_t* p) { return std::bit_cast<int32_t>(load_u32(p)); }
+
+    // big-endian reader over an in-memory class file; bulk structures should go through require()/read_bytes() so that
+    // bounds are checked once for the whole structure
+    class byte_file
+    {
+        std::span<const uint8_t> buf;
+        size_t cursor;
+
+    public:
+        inline byte_file(std::span<const uint8_t> buf) : buf(buf), cursor(0) {}
+
+        inline void require(size_t n) const
+        {
+            if (n > buf.size() - cursor)
+                throw class_parse_error("unexpected end of class file");
+        }
+
+        // a declared number of elements, each encoded in at least min_size bytes. checking it against the input that is
+        // left before reserving space keeps a corrupt count from allocating or looping far beyond the end of the file
+        inline size_t checked_count(size_t count, size_t min_size) const
+        {
+            require(count * min_size);
+            return count;
+        }
+
+        inline uint8_t read_u8()
+        {
+            require(1);
+            return buf[cursor++];
+        }
+
+        inline int8_t read_i8() { return std::bit_cast<int8_t>(read_u8()); }
+        inline int16_t read_i16() { return std::bit_cast<int16_t>(read_u16()); }
+        inline int32_t read_i32() { return std::bit_cast<int32_t>(read_u32()); }
+        inline int64_t read_i64() { return std::bit_cast<int64_t>(read_u64()); }
+
+        inline uint16_t read_u16()
+        {
+            require(2);
+            uint16_t n = load_u16(buf.data() + cursor);
+            cursor += 2;
+            return n;
+        }
+
+        inline uint32_t read_u32()
+        {
+            require(4);
+            uint32_t n = load_u32(buf.data() + cursor);
+            cursor += 4;
+            return n;
+        }
+
+        inline uint64_t read_u64()
+        {
+            require(8);
+            uint64_t n = load_u64(buf.data() + cursor);
+            cursor += 8;
+            return n;
+        }
+
+        inline std::span<const uint8_t> read_bytes(size_t n)
+        {
+            require(n);
+            auto res = buf.subspan(cursor, n);
+            cursor += n;
+            return res;
+        }
+
+        constexpr auto get_cursor() const { return cursor; }
+        constexpr auto remaining() const { return buf.size() - cursor; }
+    };
+} // namespace clazz
@@ -0,0 +1,299 @@
+// cSpell:ignore clazz
+#include "cfg.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace clazz
+{
+    namespace
+    {
+        // what an instruction does to control flow when it ends a block
+        enum class transfer : uint8_t
+        {
+            next,
+            conditional,
+            jump,
+            subroutine,
+            table,
+            exit,
+        };
+
+        transfer transfer_of(uint8_t opcode)
+        {
+            switch (opcode)
+            {
+            case 0xa7: // goto
+            case 0xc8: // goto_w
+                return transfer::jump;
+            case 0xa8: // jsr
+            case 0xc9: // jsr_w
+                return transfer::subroutine;
+            case 0xa9: // ret
+            case 0xac: // ireturn
+            case 0xad: // lreturn
+            case 0xae: // freturn
+            case 0xaf: // dreturn
+            case 0xb0: // areturn
+            case 0xb1: // return
+            case 0xbf: // athrow
+                return transfer::exit;
+            }
+
+            switch (opcode_table[opcode].kind)
+            {
+            case operand_kind::branch:
+                return transfer::conditional;
+            case operand_kind::tableswitch:
+            case operand_kind::lookupswitch:
+                return transfer::table;
+            default:
+                return transfer::next;
+            }
+        }
+
+        // wide is reported as the opcode it widens, which matters for ret
+        uint8_t flow_opcode(const inst& i)
+        {
+            const auto* wide = std::get_if<wide_data>(&i.special);
+            return wide ? wide->op : i.opcode;
+        }
+
+        uint8_t flow_opcode(inst_view i)
+        {
+            return opcode_table[i.opcode()].kind == operand_kind::wide ? (uint8_t)i.side()[0] : i.opcode();
+        }
+
+        // calls g(ip) for every branch or switch target
+        template <typename G>
+        void for_each_target(const inst& i, int64_t ip, G&& g)
+        {
+            if (const auto* off = std::get_if<address_offset>(&i.operand1))
+                g(ip + off->off);
+            else if (const auto* table = std::get_if<tableswitch_data>(&i.special))
+            {
+                g(ip + table->def.off);
+                for (auto off : table->lut)
+                    g(ip + off.off);
+            }
+            else if (const auto* table = std::get_if<lookupswitch_data>(&i.special))
+            {
+                g(ip + table->def.off);
+                for (auto [match, off] : table->lut)
+                    g(ip + off.off);
+            }
+        }
+
+        template <typename G>
+        void for_each_target(inst_view i, int64_t ip, G&& g)
+        {
+            switch (opcode_table[i.opcode()].kind)
+            {
+            case operand_kind::branch:
+                g(ip + i.operand());
+                break;
+            case operand_kind::tableswitch: {
+                const int32_t* data = i.side();
+                g(ip + data[0]);
+                for (int64_t j = 0; j < (int64_t)data[2] - data[1] + 1; j++)
+                    g(ip + data[3 + j]);
+                break;
+            }
+            case operand_kind::lookupswitch: {
+                const int32_t* data = i.side();
+                g(ip + data[0]);
+                for (int32_t j = 0; j < data[1]; j++)
+                    g(ip + data[3 + 2 * j]);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        // calls f(ip, next_ip, opcode, targets) for every instruction, where targets(g) calls g(ip) for every branch or
+        // switch target
+        template <typename F>
+        void for_each_flow(const code_attribute& code, F&& f)
+        {
+            if (code.compact.empty())
+            {
+                uint32_t ip = 0;
+                for (const auto& i : code.code)
+                {
+                    f(ip, ip + i.inst_sz, flow_opcode(i), [&](auto&& g) { for_each_target(i, ip, g); });
+                    ip += i.inst_sz;
+                }
+            }
+            else
+            {
+                for (auto i : code.compact)
+                    f(i.ip(), i.ip() + i.size(), flow_opcode(i), [&](auto&& g) { for_each_target(i, i.ip(), g); });
+            }
+        }
+
+        // like for_each_flow, for the single instruction numbered `index` that ends at `next`
+        template <typename F>
+        void flow_at(const code_attribute& code, size_t index, uint32_t next, F&& f)
+        {
+            if (code.compact.empty())
+            {
+                const inst& i = code.code[index];
+                uint32_t ip = next - i.inst_sz;
+                f(ip, next, flow_opcode(i), [&](auto&& g) { for_each_target(i, ip, g); });
+            }
+            else
+            {
+                inst_view i(code.compact, index);
+                f(i.ip(), next, flow_opcode(i), [&](auto&& g) { for_each_target(i, i.ip(), g); });
+            }
+        }
+
+        // turns per-block counts (shifted by one) into offsets and returns a cursor per block for filling
+        std::vector<uint32_t> prefix_sum(std::vector<uint32_t>& offsets)
+        {
+            for (size_t i = 1; i < offsets.size(); i++)
+                offsets[i] += offsets[i - 1];
+            return {offsets.begin(), offsets.end() - 1};
+        }
+    } // namespace
+
+    size_t control_flow_graph::block_of(uint32_t ip) const
+    {
+        auto it = std::upper_bound(block_ips.begin(), block_ips.end() - 1, ip);
+        return it == block_ips.begin() ? 0 : it - block_ips.begin() - 1;
+    }
+
+    control_flow_graph build_cfg(const code_attribute& code)
+    {
+        enum : uint8_t
+        {
+            START = 1,
+            LEADER = 2,
+        };
+
+        const uint32_t code_len = code.max_ip;
+        control_flow_graph g;
+
+        // pass 1: instruction starts and leaders, by ip. the trailing slot takes targets at the very end of the code
+        std::vector<uint8_t> marks(code_len + 1);
+        if (code_len)
+            marks[0] |= LEADER;
+        auto lead = [&](int64_t target) {
+            if (target < 0 || target >= code_len)
+                throw class_parse_error("branch target out of range: " + std::to_string(target));
+            marks[target] |= LEADER;
+        };
+        for_each_flow(code, [&](uint32_t ip, uint32_t next, uint8_t opcode, auto&& targets) {
+            marks[ip] |= START;
+            transfer t = transfer_of(opcode);
+            if (t == transfer::next)
+                return;
+            if (t != transfer::exit)
+                targets(lead);
+            marks[next] |= LEADER;
+        });
+        for (const auto& e : code.exception_table)
+        {
+            if (e.start_pc.ip >= e.end_pc.ip)
+                continue;
+            lead(e.start_pc.ip);
+            lead(e.handler_pc.ip);
+            if (e.end_pc.ip > code_len)
+                throw class_parse_error("exception range out of bounds");
+            marks[e.end_pc.ip] |= LEADER;
+        }
+
+        // blocks in ip order. most stretches of 8 bytes hold no leader, those only add to the instruction count. every
+        // target is a leader, so only those slots of block_at are ever written or read
+        std::unique_ptr<uint32_t[]> block_at(new uint32_t[code_len + 1]);
+        uint32_t insts = 0;
+        for (uint32_t ip = 0; ip < code_len; ip++)
+        {
+            while (ip + 8 <= code_len)
+            {
+                uint64_t word;
+                std::memcpy(&word, marks.data() + ip, sizeof(word));
+                if (word & (0x0101010101010101 * LEADER))
+                    break;
+                insts += std::popcount(word);
+                ip += 8;
+            }
+            if (ip == code_len)
+                break;
+
+            if (marks[ip] == (START | LEADER))
+            {
+                block_at[ip] = g.block_ips.size();
+                g.block_ips.push_back(ip);
+                g.block_insts.push_back(insts);
+            }
+            else if (marks[ip] == LEADER)
+                throw class_parse_error("branch target is not an instruction: " + std::to_string(ip));
+            insts += marks[ip] & START;
+        }
+        block_at[code_len] = g.block_ips.size();
+        g.block_ips.push_back(code_len);
+        g.block_insts.push_back(insts);
+        const size_t blocks = g.size();
+
+        // pass 2: successors, which only depend on the last instruction of each block
+        g.succ_offsets.reserve(blocks + 1);
+        g.succ_offsets.push_back(0);
+        for (uint32_t block = 0; block < blocks; block++)
+        {
+            flow_at(code, g.block_insts[block + 1] - 1, g.block_ips[block + 1], [&](uint32_t ip, uint32_t next, uint8_t opcode, auto&& targets) {
+                transfer t = transfer_of(opcode);
+                if (t == transfer::conditional || t == transfer::jump || t == transfer::subroutine || t == transfer::table)
+                    targets([&](int64_t target) { g.succ.push_back(block_at[target]); });
+                if ((t == transfer::next || t == transfer::conditional || t == transfer::subroutine) && next < code_len)
+                    g.succ.push_back(block + 1);
+            });
+
+            // switches often share targets and a branch may target the next block
+            auto first = g.succ.begin() + g.succ_offsets.back();
+            std::sort(first, g.succ.end());
+            g.succ.erase(std::unique(first, g.succ.end()), g.succ.end());
+            g.succ_offsets.push_back(g.succ.size());
+        }
+
+        g.pred_offsets.assign(blocks + 1, 0);
+        for (auto s : g.succ)
+            g.pred_offsets[s + 1]++;
+        auto cursor = prefix_sum(g.pred_offsets);
+        g.pred.resize(g.succ.size());
+        for (uint32_t b = 0; b < blocks; b++)
+            for (auto s : g.successors(b))
+                g.pred[cursor[s]++] = b;
+
+        // ranges start and end on block boundaries, so each entry covers a run of whole blocks
+        auto covered = [&](const code_attribute::exception_table_entry& e) {
+            return std::pair<size_t, size_t>(block_at[e.start_pc.ip], block_at[e.end_pc.ip]);
+        };
+        g.handler_offsets.assign(blocks + 1, 0);
+        for (const auto& e : code.exception_table)
+        {
+            if (e.start_pc.ip >= e.end_pc.ip)
+                continue;
+            auto [first, last] = covered(e);
+            for (size_t b = first; b < last; b++)
+                g.handler_offsets[b + 1]++;
+        }
+        cursor = prefix_sum(g.handler_offsets);
+        g.handler_edges.resize(g.handler_offsets.back());
+        for (size_t i = 0; i < code.exception_table.size(); i++)
+        {
+            const auto& e = code.exception_table[i];
+            if (e.start_pc.ip >= e.end_pc.ip)
+                continue;
+            auto [first, last] = covered(e);
+            uint32_t handler = block_at[e.handler_pc.ip];
+            for (size_t b = first; b < last; b++)
+                g.handler_edges[cursor[b]++] = {handler, (uint16_t)i};
+        }
+
+        return g;
+    }
+} // namespace clazz
@@ -0,0 +1,59 @@
+// cSpell:ignore clazz
+#pragma once
+#include "clazz.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace clazz
+{
+    // basic blocks of a method body and the edges between them. blocks are numbered in ip order and adjacency is stored
+    // CSR-style: the successors of block b are succ[succ_offsets[b], succ_offsets[b + 1]), likewise for predecessors and
+    // handlers. exception edges are kept apart from normal control flow, see `handlers`
+    struct control_flow_graph
+    {
+        struct exception_edge
+        {
+            uint32_t handler;
+            // index into code_attribute::exception_table, for the catch type
+            uint16_t entry;
+        };
+
+        // start ip of every block, plus a trailing entry holding the code length
+        std::vector<uint32_t> block_ips;
+        // index of the first instruction of every block, plus a trailing entry holding the instruction count
+        std::vector<uint32_t> block_insts;
+
+        std::vector<uint32_t> succ_offsets;
+        std::vector<uint32_t> succ;
+        std::vector<uint32_t> pred_offsets;
+        std::vector<uint32_t> pred;
+        // handlers covering a block, in exception table order; the block's predecessors do not include them
+        std::vector<uint32_t> handler_offsets;
+        std::vector<exception_edge> handler_edges;
+
+        constexpr size_t size() const { return block_ips.empty() ? 0 : block_ips.size() - 1; }
+
+        constexpr std::span<const uint32_t> successors(size_t block) const
+        {
+            return {succ.data() + succ_offsets[block], succ.data() + succ_offsets[block + 1]};
+        }
+        constexpr std::span<const uint32_t> predecessors(size_t block) const
+        {
+            return {pred.data() + pred_offsets[block], pred.data() + pred_offsets[block + 1]};
+        }
+        constexpr std::span<const exception_edge> handlers(size_t block) const
+        {
+            return {handler_edges.data() + handler_offsets[block], handler_edges.data() + handler_offsets[block + 1]};
+        }
+
+        // block containing the instruction at `ip`
+        size_t block_of(uint32_t ip) const;
+    };
+
+    // builds the graph of a method body in either representation. leaders are found in one pass over the instructions,
+    // edges in a second. jsr gets an edge to the subroutine as well as to the instruction after it, where the matching
+    // ret returns to; ret itself has no successors. branch targets or exception ranges that do not fall on an
+    // instruction throw class_parse_error
+    control_flow_graph build_cfg(const code_attribute& code);
+} // namespace clazz
@@ -0,0 +1,589 @@
+// cSpell:ignore clazz
+#include "class_writer.h"
+#include <bit>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace clazz
+{
+    using namespace clazz::annotations;
+    using namespace clazz::stackmap;
+
+    namespace
+    {
+        class class_file_writer
+        {
+            const class_file& clazz;
+            std::vector<uint8_t> out;
+            attribute_name_indices name_indices;
+
+            void u8(uint8_t v) { out.push_back(v); }
+
+            void u16(uint16_t v)
+            {
+                out.push_back(v >> 8);
+                out.push_back(v);
+            }
+
+            void u32(uint32_t v)
+            {
+                u16(v >> 16);
+                u16(v);
+            }
+
+            void u64(uint64_t v)
+            {
+                u32(v >> 32);
+                u32(v);
+            }
+
+            void bytes(std::span<const uint8_t> v) { out.insert(out.end(), v.begin(), v.end()); }
+
+            void count(size_t n)
+            {
+                if (n > UINT16_MAX)
+                    throw std::runtime_error("too many entries for a class file: " + std::to_string(n));
+                u16(n);
+            }
+
+            // for lengths that are only known once the data behind them is written
+            size_t reserve_u32()
+            {
+                size_t at = out.size();
+                u32(0);
+                return at;
+            }
+
+            void patch_u32(size_t at, uint32_t v)
+            {
+                for (size_t i = 0; i < 4; i++)
+                    out[at + i] = v >> (24 - 8 * i);
+            }
+
+            uint16_t name_index(std::string_view name)
+            {
+                uint16_t index = name_indices(name);
+                if (!index)
+                    throw std::runtime_error("cannot write " + std::string(name) + " attribute, its name is not in the constant pool");
+                return index;
+            }
+
+            void constant(const cp_info& c)
+            {
+                std::visit(
+                    [&]<typename T>(const T& v) {
+                        if constexpr (std::is_same_v<T, utf8_info>)
+                        {
+                            u8(1);
+                            count(v.bytes.size());
+                            bytes(v.bytes);
+                        }
+                        else if constexpr (std::is_same_v<T, integer_info>)
+                        {
+                            u8(3);
+                            u32(std::bit_cast<uint32_t>(v.value));
+                        }
+                        else if constexpr (std::is_same_v<T, float_info>)
+                        {
+                            u8(4);
+                            u32(std::bit_cast<uint32_t>(v.value));
+                        }
+                        else if constexpr (std::is_same_v<T, long_info>)
+                        {
+                            u8(5);
+                            u64(std::bit_cast<uint64_t>(v.value));
+                        }
+                        else if constexpr (std::is_same_v<T, double_info>)
+                        {
+                            u8(6);
+                            u64(std::bit_cast<uint64_t>(v.value));
+                        }
+                        else if constexpr (std::is_same_v<T, class_info>)
+                        {
+                            u8(7);
+                            u16(v.name_index.get_index());
+                        }
+                        else if constexpr (std::is_same_v<T, string_info>)
+                        {
+                            u8(8);
+                            u16(v.string_index.get_index());
+                        }
+                        else if constexpr (is_member<T>)
+                        {
+                            u8(std::is_same_v<T, fieldref_info> ? 9 : std::is_same_v<T, methodref_info> ? 10 : 11);
+                            u16(v.class_index.get_index());
+                            u16(v.name_and_type_index.get_index());
+                        }
+                        else if constexpr (std::is_same_v<T, name_and_type_info>)
+                        {
+                            u8(12);
+                            u16(v.name_index.get_index());
+                            u16(v.descriptor_index.get_index());
+                        }
+                        else if constexpr (std::is_same_v<T, method_handle_info>)
+                        {
+                            u8(15);
+                            u8(v.reference_kind);
+                            u16(v.reference_index.get_index());
+                        }
+                        else if constexpr (std::is_same_v<T, method_type_info>)
+                        {
+                            u8(16);
+                            u16(v.descriptor_index.get_index());
+                        }
+                        else if constexpr (std::is_same_v<T, invoke_dynamic_info>)
+                        {
+                            u8(18);
+                            u16(v.bootstrap_method_attr_index);
+                            u16(v.name_and_type_index.get_index());
+                        }
+                        // the unusable slot after a long or double takes no space
+                    },
+                    c);
+            }
+
+            void instruction(size_t code_start, const inst& i)
+            {
+                const opcode_info& info = opcode_table[i.opcode];
+                const int32_t operand = std::visit(
+                    []<typename T>(const T& v) -> int32_t {
+                        if constexpr (std::is_same_v<T, std::monostate>)
+                            return 0;
+                        else if constexpr (std::is_same_v<T, int>)
+                            return v;
+                        else if constexpr (std::is_same_v<T, lvt_ref>)
+                            return v.index;
+                        else if constexpr (std::is_same_v<T, address_offset>)
+                            return v.off;
+                        else if constexpr (std::is_same_v<T, primitive_type_ref>)
+                            return v.ty;
+                        else
+                            return v.get_index();
+                    },
+                    i.operand1);
+                const int32_t operand2 = std::holds_alternative<int>(i.operand2) ? std::get<int>(i.operand2) : 0;
+
+                // switch tables are aligned relative to the start of the code
+                auto pad = [&] {
+                    while ((out.size() - code_start) % 4)
+                        u8(0);
+                };
+
+                u8(i.opcode);
+                switch (info.kind)
+                {
+                case operand_kind::none:
+                case operand_kind::invalid:
+                    break;
+                case operand_kind::immediate:
+                    info.length == 2 ? u8(operand) : u16(operand);
+                    break;
+                case operand_kind::constant:
+                    i.opcode == 0x12 ? u8(operand) : u16(operand);
+                    break;
+                case operand_kind::local:
+                case operand_kind::primitive_type:
+                    u8(operand);
+                    break;
+                case operand_kind::iinc:
+                    u8(operand);
+                    u8(operand2);
+                    break;
+                case operand_kind::branch:
+                    info.length == 3 ? u16(operand) : u32(operand);
+                    break;
+                case operand_kind::field:
+                case operand_kind::method:
+                case operand_kind::class_type:
+                    u16(operand);
+                    break;
+                case operand_kind::interface_method:
+                    u16(operand);
+                    u8(operand2);
+                    u8(0);
+                    break;
+                case operand_kind::invoke_dynamic:
+                    u16(operand);
+                    u16(0);
+                    break;
+                case operand_kind::multianewarray:
+                    u16(operand);
+                    u8(operand2);
+                    break;
+                case operand_kind::wide: {
+                    uint8_t op = std::get<wide_data>(i.special).op;
+                    u8(op);
+                    u16(operand);
+                    if (opcode_table[op].kind == operand_kind::iinc)
+                        u16(operand2);
+                    break;
+                }
+                case operand_kind::tableswitch: {
+                    const auto& data = std::get<tableswitch_data>(i.special);
+                    pad();
+                    u32(data.def.off);
+                    u32(data.low);
+                    u32(data.high);
+                    for (auto off : data.lut)
+                        u32(off.off);
+                    break;
+                }
+                case operand_kind::lookupswitch: {
+                    const auto& data = std::get<lookupswitch_data>(i.special);
+                    pad();
+                    u32(data.def.off);
+                    u32(data.lut.size());
+                    for (auto [match, off] : data.lut)
+                    {
+                        u32(match);
+                        u32(off.off);
+                    }
+                    break;
+                }
+                }
+            }
+
+            void verification_type(const verification_type_info& v)
+            {
+                u8(v.tag);
+                if (v.tag >= VERIFICATION_OBJECT)
+                    u16(v.data);
+            }
+
+            void element(const element_value& e)
+            {
+                u8(e.tag);
+                std::visit(
+                    [&]<typename T>(const T& v) {
+                        if constexpr (std::is_same_v<T, element_value::enum_const_value>)
+                        {
+                            u16(v.type_name_index.get_index());
+                            u16(v.const_name_index.get_index());
+                        }
+                        else if constexpr (std::is_same_v<T, annotation>)
+                            write_annotation(v);
+                        else if constexpr (std::is_same_v<T, std::pmr::vector<element_value>>)
+                        {
+                            count(v.size());
+                            for (const auto& i : v)
+                                element(i);
+                        }
+                        else
+                            u16(v.get_index());
+                    },
+                    e.value);
+            }
+
+            void write_annotation(const annotation& a)
+            {
+                u16(a.type_index.get_index());
+                count(a.entries.size());
+                for (const auto& e : a.entries)
+                {
+                    u16(e.name.get_index());
+                    element(e.value);
+                }
+            }
+
+            void write_type_annotation(const type_annotation& a)
+            {
+                u8(a.target_type);
+                std::visit(
+                    [&]<typename T>(const T& v) {
+                        using ta = type_annotation;
+                        if constexpr (std::is_same_v<T, ta::type_parameter_target>)
+                            u8(v.type_parameter_index);
+                        else if constexpr (std::is_same_v<T, ta::supertype_target>)
+                            u16(v.supertype_index);
+                        else if constexpr (std::is_same_v<T, ta::type_parameter_bound_target>)
+                        {
+                            u8(v.type_parameter_index);
+                            u8(v.bound_index);
+                        }
+                        else if constexpr (std::is_same_v<T, ta::formal_parameter_target>)
+                            u8(v.formal_parameter_index);
+                        else if constexpr (std::is_same_v<T, ta::throws_target>)
+                            u16(v.throws_type_index);
+                        else if constexpr (std::is_same_v<T, ta::localvar_target>)
+                        {
+                            count(v.table.size());
+                            for (auto e : v.table)
+                            {
+                                u16(e.start_pc);
+                                u16(e.length);
+                                u16(e.index);
+                            }
+                        }
+                        else if constexpr (std::is_same_v<T, ta::catch_target>)
+                            u16(v.exception_table_index);
+                        else if constexpr (std::is_same_v<T, ta::offset_target>)
+                            u16(v.offset);
+                        else if constexpr (std::is_same_v<T, ta::type_argument_target>)
+                        {
+                            u16(v.offset);
+                            u8(v.type_argument_index);
+                        }
+                    },
+                    a.target_info);
+
+                u8(a.target_path.path.size());
+                for (auto e : a.target_path.path)
+                {
+                    u8(e.type_path_kind);
+                    u8(e.type_argument_index);
+                }
+                u16(a.type_index.get_index());
+                count(a.entries.size());
+                for (const auto& [name, value] : a.entries)
+                {
+                    u16(name.get_index());
+                    element(value);
+                }
+            }
+
+            void body(const code_attribute& attr)
+            {
+                u16(attr.max_stack);
+                u16(attr.max_locals);
+                size_t length = reserve_u32();
+                size_t start = out.size();
+                for_each_instruction(clazz, attr, [&](size_t, const inst& i) { instruction(start, i); });
+                patch_u32(length, out.size() - start);
+
+                count(attr.exception_table.size());
+                for (const auto& e : attr.exception_table)
+                {
+                    u16(e.start_pc.ip);
+                    u16(e.end_pc.ip);
+                    u16(e.handler_pc.ip);
+                    u16(e.catch_type.get_index());
+                }
+                attributes(attr.attributes);
+            }
+
+            void body(const signature_attribute& attr) { u16(attr.signature_index.get_index()); }
+            void body(const source_file_attribute& attr) { u16(attr.sourcefile_index.get_index()); }
+            void body(const nest_host_attribute& attr) { u16(attr.host_class_index.get_index()); }
+            void body(const constant_value_attribute& attr) { u16(attr.constantvalue_index.get_index()); }
+
+            void body(const enclosing_method_attribute& attr)
+            {
+                u16(attr.class_index.get_index());
+                u16(attr.method_index.get_index());
+            }
+
+            template <typename T>
+            requires(std::is_same_v<T, lvt_attribute> || std::is_same_v<T, lvt_type_attribute>) void body(const T& attr)
+            {
+                count(attr.lvt.size());
+                for (const auto& e : attr.lvt)
+                {
+                    u16(e.start_pc.ip);
+                    u16(e.length);
+                    u16(e.name_index.get_index());
+                    if constexpr (std::is_same_v<T, lvt_attribute>)
+                        u16(e.descriptor_index.get_index());
+                    else
+                        u16(e.signature_index.get_index());
+                    u16(e.index.index);
+                }
+            }
+
+            void body(const inner_class_attribute& attr)
+            {
+                count(attr.inner_classes.size());
+                for (const auto& e : attr.inner_classes)
+                {
+                    u16(e.inner_class_info_index.get_index());
+                    u16(e.outer_class_info_index.get_index());
+                    u16(e.inner_name_index.get_index());
+                    u16(e.inner_class_access_flags);
+                }
+            }
+
+            void body(const lineno_attribute& attr)
+            {
+                count(attr.line_number_table.size());
+                for (const auto& e : attr.line_number_table)
+                {
+                    u16(e.start_pc.ip);
+                    u16(e.line_number);
+                }
+            }
+
+            void body(const stack_map_table_attribute& attr)
+            {
+                count(attr.entries.size());
+                for (const auto& frame : attr.entries)
+                {
+                    u8(frame.frame_type);
+                    std::visit(
+                        [&]<typename T>(const T& f) {
+                            using smf = stack_map_frame;
+                            if constexpr (std::is_same_v<T, smf::same_locals_1_stack_item_frame>)
+                                verification_type(f.stack);
+                            else if constexpr (std::is_same_v<T, smf::same_locals_1_stack_item_frame_extended>)
+                            {
+                                u16(f.offset_delta);
+                                verification_type(f.stack);
+                            }
+                            else if constexpr (std::is_same_v<T, smf::chop_frame> || std::is_same_v<T, smf::same_frame_extended>)
+                                u16(f.offset_delta);
+                            else if constexpr (std::is_same_v<T, smf::append_frame>)
+                            {
+                                // the number of locals follows from the frame type
+                                u16(f.offset_delta);
+                                for (auto v : f.locals)
+                                    verification_type(v);
+                            }
+                            else if constexpr (std::is_same_v<T, smf::full_frame>)
+                            {
+                                u16(f.offset_delta);
+                                count(f.locals.size());
+                                for (auto v : f.locals)
+                                    verification_type(v);
+                                count(f.stack.size());
+                                for (auto v : f.stack)
+                                    verification_type(v);
+                            }
+                        },
+                        frame.data);
+                }
+            }
+
+            void body(const bootstrap_methods_attribute& attr)
+            {
+                count(attr.bootstrap_methods.size());
+                for (const auto& e : attr.bootstrap_methods)
+                {
+                    u16(e.bootstrap_method_ref.get_index());
+                    count(e.bootstrap_arguments.size());
+                    for (auto arg : e.bootstrap_arguments)
+                        u16(arg.get_index());
+                }
+            }
+
+            void body(const nest_members_attribute& attr)
+            {
+                count(attr.classes.size());
+                for (auto c : attr.classes)
+                    u16(c.get_index());
+            }
+
+            void body(const exceptions_attribute& attr)
+            {
+                count(attr.exception_index_table.size());
+                for (auto c : attr.exception_index_table)
+                    u16(c.get_index());
+            }
+
+            template <typename T>
+            requires(std::is_same_v<T, runtime_visible_annotations_attribute> || std::is_same_v<T, runtime_invisible_annotations_attribute>) void body(
+                const T& attr)
+            {
+                count(attr.annotations.size());
+                for (const auto& a : attr.annotations)
+                    write_annotation(a);
+            }
+
+            template <typename T>
+            requires(std::is_same_v<T, runtime_visible_type_annotations_attribute> ||
+                     std::is_same_v<T, runtime_invisible_type_annotations_attribute>) void body(const T& attr)
+            {
+                count(attr.annotations.size());
+                for (const auto& a : attr.annotations)
+                    write_type_annotation(a);
+            }
+
+            template <typename T>
+            requires(std::is_same_v<T, runtime_visible_parameter_annotations_attribute> ||
+                     std::is_same_v<T, runtime_invisible_parameter_annotations_attribute>) void body(const T& attr)
+            {
+                if (attr.annotations.size() > UINT8_MAX)
+                    throw std::runtime_error("too many annotated parameters for a class file: " + std::to_string(attr.annotations.size()));
+                u8(attr.annotations.size());
+                for (const auto& parameter : attr.annotations)
+                {
+                    count(parameter.size());
+                    for (const auto& a : parameter)
+                        write_annotation(a);
+                }
+            }
+
+            void attributes(const std::pmr::vector<attribute>& attrs)
+            {
+                count(attrs.size());
+                for (const auto& attr : attrs)
+                {
+                    std::visit(
+                        [&]<typename T>(const T& v) {
+                            if constexpr (std::is_same_v<T, attribute_info>)
+                            {
+                                u16(v.attribute_name_index.get_index());
+                                u32(v.buffer.size());
+                                bytes(v.buffer);
+                            }
+                            else if constexpr (std::is_same_v<T, lazy_attribute>)
+                            {
+                                u16(v.attribute_name_index.get_index());
+                                u32(v.bytes.size());
+                                bytes(v.bytes);
+                            }
+                            else
+                            {
+                                u16(name_index(attribute_name<T>()));
+                                size_t length = reserve_u32();
+                                body(v);
+                                patch_u32(length, out.size() - length - 4);
+                            }
+                        },
+                        attr);
+                }
+            }
+
+            template <typename T>
+            void members(const std::pmr::vector<T>& v)
+            {
+                count(v.size());
+                for (const auto& m : v)
+                {
+                    u16(m.access_flags);
+                    u16(m.name_index.get_index());
+                    u16(m.descriptor_index.get_index());
+                    attributes(m.attributes);
+                }
+            }
+
+        public:
+            class_file_writer(const class_file& clazz) : clazz(clazz), name_indices(clazz) {}
+
+            std::vector<uint8_t> write() &&
+            {
+                u32(clazz.magic);
+                u16(clazz.minor_version);
+                u16(clazz.major_version);
+                count(clazz.constant_pool.size() + 1);
+                for (const auto& c : clazz.constant_pool)
+                    constant(c);
+
+                u16(clazz.access_flags);
+                u16(clazz.this_class.get_index());
+                u16(clazz.super_class.get_index());
+                count(clazz.interfaces.size());
+                for (auto i : clazz.interfaces)
+                    u16(i.get_index());
+
+                members(clazz.fields);
+                members(clazz.methods);
+                attributes(clazz.attributes);
+                return std::move(out);
+            }
+        };
+    } // namespace
+
+    std::vector<uint8_t> write_class(const class_file& clazz) { return class_file_writer(clazz).write(); }
+} // namespace clazz
@@ -0,0 +1,13 @@
+// cSpell:ignore clazz
+#pragma once
+#include "clazz.h"
+#include <cstdint>
+#include <vector>
+
+namespace clazz
+{
+    // serialises a class back into the class file format. decoded attributes are written under the utf8 constant that
+    // holds their name, which has to be in the constant pool; raw and lazy attributes are copied as they are. method
+    // bodies may be in either representation. parsing the result yields the same class again
+    std::vector<uint8_t> write_class(const class_file& clazz);
+} // namespace clazz
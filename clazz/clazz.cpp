@@ -1,61 +1,35 @@
 // cSpell:ignore clazz
+#include "byte_file.h"
 #include "clazz.h"
+#include "mapped_file.h"
+#include "mutf8.h"
+#include "stats.h"
+#include <algorithm>
 #include <bit>
 #include <cstdint>
-#include <fstream>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <stdexcept>
+#include <string_view>
 namespace clazz
 {
-    class byte_file
+    // converts to an empty std::pmr::vector of any element type bound to the arena of a class. containers have to be
+    // created through this rather than assigned later, since moving between different resources degrades to a copy
+    struct arena_vector
     {
-        std::ifstream ifs;
-        size_t cursor;
+        std::pmr::memory_resource* resource;
 
-    public:
-        inline byte_file(std::string path) : ifs(path, std::ios::binary), cursor(0) {}
-
-        inline uint8_t read_u8()
+        template <typename T>
+        operator std::pmr::vector<T>() const
         {
-            uint8_t n;
-            ifs.read((char*)&n, 1);
-            cursor++;
-            return n;
+            return std::pmr::vector<T>(resource);
         }
-
-        inline int8_t read_i8() { return std::bit_cast<int8_t>(read_u8()); }
-        inline int16_t read_i16() { return std::bit_cast<int16_t>(read_u16()); }
-        inline int32_t read_i32() { return std::bit_cast<int32_t>(read_u32()); }
-        inline int64_t read_i64() { return std::bit_cast<int64_t>(read_u64()); }
-
-        inline uint16_t read_u16()
-        {
-            uint16_t n;
-            ifs.read((char*)&n, 2);
-            cursor += 2;
-            return __builtin_bswap16(n);
-        }
-
-        inline uint32_t read_u32()
-        {
-            uint32_t n;
-            ifs.read((char*)&n, 4);
-            cursor += 4;
-            return __builtin_bswap32(n);
-        }
-
-        inline uint64_t read_u64()
-        {
-            uint64_t n;
-            ifs.read((char*)&n, 8);
-            cursor += 8;
-            return __builtin_bswap64(n);
-        }
-
-        constexpr const auto& get_stream() const { return ifs; }
-        constexpr auto& get_stream() { return ifs; }
-        constexpr auto get_cursor() const { return cursor; }
     };
 
+    static inline arena_vector arena(const class_file& clazz) { return {clazz.arena.get()}; }
+
     template <class... Args>
     struct variant_cast_proxy
     {
@@ -89,237 +63,257 @@ namespace clazz
             clazz.constant_pool[index - 1]);
     }
 
-    static attribute parse_attribute(class_file& clazz, byte_file& bf, size_t index);
+    static attribute parse_attribute(class_file& clazz, byte_file& bf, size_t index, const parse_options& options);
+
+    int32_t raw_operand(const inst::operand_1_t& operand)
+    {
+        return std::visit(
+            []<typename T>(const T& v) -> int32_t {
+                if constexpr (std::is_same_v<T, std::monostate>)
+                    return 0;
+                else if constexpr (std::is_same_v<T, int>)
+                    return v;
+                else if constexpr (std::is_same_v<T, lvt_ref>)
+                    return v.index;
+                else if constexpr (std::is_same_v<T, address_offset>)
+                    return v.off;
+                else if constexpr (std::is_same_v<T, primitive_type_ref>)
+                    return v.ty;
+                else
+                    return v.get_index();
+            },
+            operand);
+    }
+
+    uint16_t attribute_name_indices::operator()(std::string_view name)
+    {
+        for (auto [n, index] : names)
+            if (n == name)
+                return index;
+
+        uint16_t index = 0;
+        for (size_t i = 0; i < clazz.constant_pool.size(); i++)
+        {
+            const auto* utf8 = std::get_if<utf8_info>(&clazz.constant_pool[i]);
+            if (utf8 && std::string_view((const char*)utf8->bytes.data(), utf8->bytes.size()) == name)
+            {
+                index = i + 1;
+                break;
+            }
+        }
+        names.emplace_back(name, index);
+        return index;
+    }
+
+    void append_compact(compact_code& code, const inst& curr, size_t ip)
+    {
+        int32_t operand = raw_operand(curr.operand1);
+        int16_t operand2 = std::holds_alternative<int>(curr.operand2) ? std::get<int>(curr.operand2) : 0;
+
+        std::visit(
+            [&]<typename T>(const T& data) {
+                if constexpr (std::is_same_v<T, tableswitch_data>)
+                {
+                    operand = code.side.size();
+                    code.side.insert(code.side.end(), {data.def.off, data.low, data.high});
+                    for (auto i : data.lut)
+                        code.side.push_back(i.off);
+                }
+                else if constexpr (std::is_same_v<T, lookupswitch_data>)
+                {
+                    operand = code.side.size();
+                    code.side.insert(code.side.end(), {data.def.off, (int32_t)data.lut.size()});
+                    for (auto [match, off] : data.lut)
+                        code.side.insert(code.side.end(), {match, off.off});
+                }
+                else if constexpr (std::is_same_v<T, wide_data>)
+                {
+                    code.side.insert(code.side.end(), {data.op, operand});
+                    operand = code.side.size() - 2;
+                }
+            },
+            curr.special);
+
+        code.opcodes.push_back(curr.opcode);
+        code.ips.push_back(ip);
+        code.operands.push_back(operand);
+        code.operands2.push_back(operand2);
+    }
 
-    static code_attribute parse_code_attribute(class_file& clazz, byte_file& bf)
+    static code_attribute parse_code_attribute(class_file& clazz, byte_file& bf, const parse_options& options)
     {
-        code_attribute attr;
+        stats::scoped_phase timer(stats::phase::code);
+        code_attribute attr{0, 0, 0, arena(clazz), arena(clazz), arena(clazz), {arena(clazz), arena(clazz), arena(clazz), arena(clazz), arena(clazz)}};
         attr.max_stack = bf.read_u16();
         attr.max_locals = bf.read_u16();
         const uint32_t code_len = attr.max_ip = bf.read_u32();
+        bf.require(code_len);
         const size_t expected = code_len + bf.get_cursor();
+
+        // in compact mode switch tables are copied into the side table, keep the temporaries out of the arena
+        std::pmr::memory_resource* scratch = options.compact_code ? std::pmr::new_delete_resource() : clazz.arena.get();
+        if (options.compact_code)
+        {
+            // most instructions are one to three bytes long
+            size_t estimate = code_len / 2 + 1;
+            attr.compact.opcodes.reserve(estimate);
+            attr.compact.ips.reserve(estimate + 1);
+            attr.compact.operands.reserve(estimate);
+            attr.compact.operands2.reserve(estimate);
+        }
+
         size_t ip = 0;
-        for (; ip < code_len; ip++)
-        {
-            // TODO: remove
-            size_t ip0 = ip;
-            size_t cur0 = bf.get_cursor();
-
-            inst curr;
-            curr.inst_sz = 1;
-            uint8_t opcode = bf.read_u8();
-            curr.opcode = opcode;
-            if (opcode <= 0x0f || (opcode >= 0x1a && opcode <= 0x35) || (opcode >= 0x3b && opcode <= 0x98 && opcode != 0x84) ||
-                (opcode >= 0xac && opcode <= 0xb1))
-                ;
-            else if (opcode == 0xbe || opcode == 0xbf || opcode == 0xc2 || opcode == 0xc3 || opcode == 0xca)
-                ;
-            else if (opcode == 0x10)
-            {
-                ip++;
-                curr.inst_sz++;
-                curr.operand1 = (int)bf.read_i8();
-            }
-            else if (opcode == 0x11)
-            {
-                ip += 2;
-                curr.inst_sz += 2;
-                curr.operand1 = (int)bf.read_i16();
-            }
-            else if (opcode == 0x12)
-            {
-                ip++;
-                curr.inst_sz++;
-                curr.operand1 = variant_cast(
-                    expand_ref<string_info, integer_info, float_info, class_info, method_type_info, method_handle_info>(clazz, bf.read_u8()));
-            }
-            else if (opcode == 0x13 || opcode == 0x14)
-            {
-                ip += 2;
-                curr.inst_sz += 2;
-                curr.operand1 = variant_cast(
-                    expand_ref<string_info, integer_info, float_info, long_info, double_info, class_info, method_type_info, method_handle_info>(
-                        clazz, bf.read_u16()));
-            }
-            else if (opcode >= 0x15 && opcode <= 0x19)
-            {
-                ip++;
-                curr.inst_sz++;
-                curr.operand1 = (lvt_ref)bf.read_u8();
-            }
-            else if (opcode >= 0x36 && opcode <= 0x3a)
-            {
-                ip++;
-                curr.inst_sz++;
-                curr.operand1 = (lvt_ref)bf.read_u8();
-            }
-            else if (opcode == 0x84)
-            {
-                ip += 2;
-                curr.inst_sz += 2;
-                curr.operand1 = (lvt_ref)bf.read_u8();
-                curr.operand2 = (int)bf.read_u8();
-            }
-            else if ((opcode >= 0x99 && opcode <= 0xa8) || opcode == 0xc6 || opcode == 0xc7)
-            {
-                ip += 2;
-                curr.inst_sz += 2;
-                curr.operand1 = (address_offset)bf.read_i16();
-            }
-            else if (opcode >= 0xb2 && opcode <= 0xb5)
-            {
-                ip += 2;
-                curr.inst_sz += 2;
-                curr.operand1 = fieldref_ref(clazz, bf.read_u16());
-            }
-            else if (opcode >= 0xb6 && opcode <= 0xb8)
+        while (ip < code_len)
+        {
+            const uint8_t opcode = bf.read_u8();
+            const opcode_info& info = opcode_table[opcode];
+
+            inst curr{info.length, opcode};
+            // fixed length operands are fetched with a single bounds check
+            const uint8_t* imm = info.length > 1 ? bf.read_bytes(info.length - 1).data() : nullptr;
+
+            switch (info.kind)
             {
-                ip += 2;
-                curr.inst_sz += 2;
-                uint16_t ref = bf.read_u16();
+            case operand_kind::none:
+                break;
+            case operand_kind::immediate:
+                curr.operand1 = info.length == 2 ? (int)(int8_t)imm[0] : (int)(int16_t)load_u16(imm);
+                break;
+            case operand_kind::constant:
+                if (opcode == 0x12)
+                    curr.operand1 = variant_cast(
+                        expand_ref<string_info, integer_info, float_info, class_info, method_type_info, method_handle_info>(clazz, imm[0]));
+                else
+                    curr.operand1 = variant_cast(
+                        expand_ref<string_info, integer_info, float_info, long_info, double_info, class_info, method_type_info, method_handle_info>(
+                            clazz, load_u16(imm)));
+                break;
+            case operand_kind::local:
+                curr.operand1 = (lvt_ref)imm[0];
+                break;
+            case operand_kind::iinc:
+                curr.operand1 = (lvt_ref)imm[0];
+                curr.operand2 = (int)(int8_t)imm[1];
+                break;
+            case operand_kind::branch:
+                curr.operand1 = (address_offset)(info.length == 3 ? (int16_t)load_u16(imm) : load_i32(imm));
+                break;
+            case operand_kind::field:
+                curr.operand1 = fieldref_ref(clazz, load_u16(imm));
+                break;
+            case operand_kind::method: {
+                uint16_t ref = load_u16(imm);
                 if (opcode == 0xb8 && ref != 0 && ref <= clazz.constant_pool.size() &&
                     std::holds_alternative<interface_methodref_info>(clazz.constant_pool[ref - 1]))
                     curr.operand1 = interface_methodref_ref(clazz, ref);
                 else
                     curr.operand1 = methodref_ref(clazz, ref);
+                break;
             }
-            else if (opcode == 0xb9)
-            {
-                ip += 4;
-                curr.inst_sz += 4;
-                curr.operand1 = interface_methodref_ref(clazz, bf.read_u16());
-                curr.operand2 = (int)bf.read_u8();
-                bf.read_u8(); // move cursor forward to skip the zero
-            }
-            else if (opcode == 0xba)
-            {
-                ip += 4;
-                curr.inst_sz += 4;
-                curr.operand1 = invoke_dynamic_ref(clazz, bf.read_u16());
-                bf.read_u16(); // move cursor forward to skip the zero
-            }
-            else if (opcode == 0xbc)
-            {
-                ip++;
-                curr.inst_sz++;
-                curr.operand1 = (primitive_type_ref)bf.read_u8();
-            }
-            else if (opcode == 0xbd || opcode == 0xc0 || opcode == 0xc1 || opcode == 0xbb)
-            {
-                ip += 2;
-                curr.inst_sz += 2;
-                curr.operand1 = class_ref(clazz, bf.read_u16());
-            }
-            else if (opcode == 0xc4)
-            {
+            case operand_kind::interface_method:
+                // the trailing zero byte is skipped
+                curr.operand1 = interface_methodref_ref(clazz, load_u16(imm));
+                curr.operand2 = (int)imm[2];
+                break;
+            case operand_kind::invoke_dynamic:
+                curr.operand1 = invoke_dynamic_ref(clazz, load_u16(imm));
+                break;
+            case operand_kind::primitive_type:
+                curr.operand1 = (primitive_type_ref)imm[0];
+                break;
+            case operand_kind::class_type:
+                curr.operand1 = class_ref(clazz, load_u16(imm));
+                break;
+            case operand_kind::multianewarray:
+                curr.operand1 = class_ref(clazz, load_u16(imm));
+                curr.operand2 = (int)imm[2];
+                break;
+            case operand_kind::wide: {
                 uint8_t real_op = bf.read_u8();
-                ip++;
-                curr.inst_sz++;
-
-                wide_data data{real_op};
-
-                if (real_op == 0x84)
+                operand_kind real_kind = opcode_table[real_op].kind;
+                if (real_kind == operand_kind::iinc)
                 {
-                    ip += 4;
-                    curr.inst_sz += 4;
+                    curr.inst_sz = 6;
                     curr.operand1 = (lvt_ref)bf.read_u16();
-                    curr.operand2 = (int)bf.read_u16();
+                    curr.operand2 = (int)bf.read_i16();
                 }
-                else if ((real_op >= 0x15 && real_op <= 0x19) || (real_op >= 0x36 && real_op <= 0x3a))
+                else if (real_kind == operand_kind::local)
                 {
-                    ip += 2;
-                    curr.inst_sz += 2;
+                    curr.inst_sz = 4;
                     curr.operand1 = lvt_ref{bf.read_u16()};
                 }
                 else
-                {
                     throw class_parse_error("invalid operand for wide");
-                }
 
-                curr.special = data;
-            }
-            else if (opcode == 0xc5)
-            {
-                ip += 3;
-                curr.inst_sz += 3;
-                curr.operand1 = class_ref(clazz, bf.read_u16());
-                curr.operand2 = (int)bf.read_u8();
-            }
-            else if (opcode == 0xc8 || opcode == 0xc9)
-            {
-                ip += 4;
-                curr.inst_sz += 4;
-                curr.operand1 = (address_offset)bf.read_i32();
+                curr.special = wide_data{real_op};
+                break;
             }
-            else if (opcode == 0xaa)
-            {
-                while (ip + 1 & 0b11)
-                {
-                    curr.inst_sz++;
-                    ip++;
-                    bf.read_u8(); // move on
-                }
+            case operand_kind::tableswitch: {
+                size_t pad = (4 - ((ip + 1) & 0b11)) & 0b11;
+                bf.read_bytes(pad); // move on
 
-                curr.inst_sz += 12;
-                ip += 12;
                 tableswitch_data data{
                     bf.read_i32(),
                     bf.read_i32(),
                     bf.read_i32(),
+                    arena_vector{scratch},
                 };
 
                 if (data.low > data.high)
                     throw class_parse_error("tableswitch low must <= high");
 
-                curr.inst_sz += 4 * (data.high - data.low + 1);
-                ip += 4 * (data.high - data.low + 1);
+                size_t count = (size_t)((int64_t)data.high - data.low + 1);
+                auto table = bf.read_bytes(4 * count);
+                curr.inst_sz = 1 + pad + 12 + 4 * count;
 
-                for (size_t j = 0; j < (data.high - data.low + 1); j++)
-                    data.lut.push_back(bf.read_i32());
+                data.lut.reserve(count);
+                for (size_t j = 0; j < count; j++)
+                    data.lut.push_back(load_i32(table.data() + 4 * j));
 
                 curr.special = std::move(data);
+                break;
             }
-            else if (opcode == 0xab)
-            {
-                while (ip + 1 & 0b11)
-                {
-                    curr.inst_sz++;
-                    ip++;
-                    bf.read_u8(); // move on
-                }
-
-                curr.inst_sz += 8;
-                ip += 8;
+            case operand_kind::lookupswitch: {
+                size_t pad = (4 - ((ip + 1) & 0b11)) & 0b11;
+                bf.read_bytes(pad); // move on
 
                 lookupswitch_data data{
                     bf.read_i32(),
+                    arena_vector{scratch},
                 };
 
                 uint32_t len = bf.read_u32();
+                auto table = bf.read_bytes(8 * (size_t)len);
+                curr.inst_sz = 1 + pad + 8 + 8 * (size_t)len;
 
-                curr.inst_sz += 8 * len;
-                ip += 8 * len;
+                data.lut.reserve(len);
                 for (size_t j = 0; j < len; j++)
-                    data.lut.push_back({bf.read_i32(), bf.read_i32()});
+                    data.lut.push_back({load_i32(table.data() + 8 * j), load_i32(table.data() + 8 * j + 4)});
 
                 curr.special = std::move(data);
+                break;
             }
-            else
-            {
+            case operand_kind::invalid:
                 throw class_parse_error(std::string("not implemented: ") + std::to_string(opcode));
             }
 
-            attr.code.push_back(curr);
-
-            if (bf.get_cursor() - cur0 != (ip - ip0 + 1))
-                throw class_parse_error("bad");
+            size_t next_ip = ip + curr.inst_sz;
+            if (options.compact_code)
+                append_compact(attr.compact, curr, ip);
+            else
+                attr.code.push_back(std::move(curr));
+            ip = next_ip;
         }
 
-        if (expected != bf.get_cursor())
+        if (ip != code_len || expected != bf.get_cursor())
             throw class_parse_error("internal state inconsistency");
 
+        if (options.compact_code)
+            attr.compact.ips.push_back(code_len);
+        stats::add(stats::counter::instructions, options.compact_code ? attr.compact.opcodes.size() : attr.code.size());
+
         uint16_t exception_table_length = bf.read_u16();
-        attr.exception_table.reserve(exception_table_length);
+        attr.exception_table.reserve(bf.checked_count(exception_table_length, 8));
 
         for (size_t i = 0; i < exception_table_length; i++)
         {
@@ -332,9 +326,9 @@ namespace clazz
         }
 
         uint16_t attribute_count = bf.read_u16();
-        attr.attributes.reserve(attribute_count);
+        attr.attributes.reserve(bf.checked_count(attribute_count, 6));
         for (size_t i = 0; i < attribute_count; i++)
-            attr.attributes.push_back(parse_attribute(clazz, bf, 0));
+            attr.attributes.push_back(parse_attribute(clazz, bf, 0, options));
         return attr;
     }
 
@@ -353,22 +347,22 @@ namespace clazz
     static bootstrap_methods_attribute parse_boostrap_method(const class_file& clazz, byte_file& bf)
     {
         uint16_t len = bf.read_u16();
-        bootstrap_methods_attribute attr;
-        attr.bootstrap_methods.reserve(len);
+        bootstrap_methods_attribute attr{arena(clazz)};
+        attr.bootstrap_methods.reserve(bf.checked_count(len, 4));
         for (size_t i = 0; i < len; i++)
         {
-            bootstrap_methods_attribute::bootstrap_methods_entry entry;
+            bootstrap_methods_attribute::bootstrap_methods_entry entry{{}, arena(clazz)};
             entry.bootstrap_method_ref = method_handle_ref(clazz, bf.read_u16());
             auto kind = entry.bootstrap_method_ref.get(clazz).reference_kind;
             if (kind != 6 && kind != 8)
                 throw class_parse_error("expected kind to be 6 or 8");
 
             uint16_t num_bootstrap_args = bf.read_u16();
-            entry.bootstrap_arguments.reserve(num_bootstrap_args);
+            entry.bootstrap_arguments.reserve(bf.checked_count(num_bootstrap_args, 2));
 
             for (size_t j = 0l; j < num_bootstrap_args; j++)
                 entry.bootstrap_arguments.push_back(any_cp_ref(clazz, bf.read_u16()));
-            attr.bootstrap_methods.push_back(entry);
+            attr.bootstrap_methods.push_back(std::move(entry));
         }
 
         return attr;
@@ -377,8 +371,8 @@ namespace clazz
     static stack_map_table_attribute parse_stack_map(const class_file& clazz, byte_file& bf)
     {
         uint16_t len = bf.read_u16();
-        stack_map_table_attribute attr;
-        attr.entries.reserve(len);
+        stack_map_table_attribute attr{arena(clazz)};
+        attr.entries.reserve(bf.checked_count(len, 1));
         for (size_t i = 0; i < len; i++)
         {
             uint8_t frame_type = bf.read_u8();
@@ -395,35 +389,37 @@ namespace clazz
                 frame.data = stack_map_frame::chop_frame{bf.read_u16()};
             else if (frame_type == 251)
                 frame.data = stack_map_frame::same_frame_extended{bf.read_u16()};
+            else if (frame_type < 247)
+                throw class_parse_error("reserved stack map frame type");
             else if (frame_type >= 252 && frame_type <= 254)
             {
                 size_t n = frame_type - 251;
-                stack_map_frame::append_frame curr_frame{bf.read_u16()};
+                stack_map_frame::append_frame curr_frame{bf.read_u16(), arena(clazz)};
 
                 curr_frame.locals.reserve(n);
                 for (size_t i = 0; i < n; i++)
                     curr_frame.locals.push_back(parse_verification_type_info(clazz, bf));
-                frame.data = curr_frame;
+                frame.data = std::move(curr_frame);
             }
             else
             {
-                stack_map_frame::full_frame curr_frame{bf.read_u16()};
+                stack_map_frame::full_frame curr_frame{bf.read_u16(), arena(clazz), arena(clazz)};
 
                 uint16_t number_of_locals = bf.read_u16();
-                curr_frame.locals.reserve(number_of_locals);
+                curr_frame.locals.reserve(bf.checked_count(number_of_locals, 1));
                 for (size_t i = 0; i < number_of_locals; i++)
                     curr_frame.locals.push_back(parse_verification_type_info(clazz, bf));
 
                 uint16_t number_of_stack_items = bf.read_u16();
 
-                curr_frame.stack.reserve(number_of_stack_items);
+                curr_frame.stack.reserve(bf.checked_count(number_of_stack_items, 1));
                 for (size_t i = 0; i < number_of_stack_items; i++)
                     curr_frame.stack.push_back(parse_verification_type_info(clazz, bf));
 
-                frame.data = curr_frame;
+                frame.data = std::move(curr_frame);
             }
 
-            attr.entries.push_back(frame);
+            attr.entries.push_back(std::move(frame));
         }
 
         return attr;
@@ -433,18 +429,25 @@ namespace clazz
 
     static type_path parse_type_path(const class_file& clazz, byte_file& bf)
     {
-        type_path p;
+        type_path p{arena(clazz)};
         uint8_t len = bf.read_u8();
-        p.path.reserve(len);
+        p.path.reserve(bf.checked_count(len, 2));
         for (size_t i = 0; i < len; i++)
             p.path.push_back({bf.read_u8(), bf.read_u8()});
         return p;
     }
 
-    static annotation parse_annotation(const class_file& clazz, byte_file& bf);
+    // element values nest through arrays and annotations. each level only takes a few bytes of input but a stack frame
+    // of the parser, so the depth is bounded well below what a thread's stack can hold
+    static constexpr size_t MAX_ELEMENT_DEPTH = 256;
+
+    static annotation parse_annotation(const class_file& clazz, byte_file& bf, size_t depth = 0);
 
-    static element_value parse_element_value(const class_file& clazz, byte_file& bf)
+    static element_value parse_element_value(const class_file& clazz, byte_file& bf, size_t depth = 0)
     {
+        if (depth > MAX_ELEMENT_DEPTH)
+            throw class_parse_error("element values nested too deeply");
+
         element_value value;
         value.tag = bf.read_u8();
         switch (value.tag)
@@ -486,15 +489,15 @@ namespace clazz
             value.value = utf8_ref(clazz, bf.read_u16());
             break;
         case '@':
-            value.value = parse_annotation(clazz, bf);
+            value.value = parse_annotation(clazz, bf, depth + 1);
             break;
         case '[': {
             uint16_t len = bf.read_u16();
-            std::vector<element_value> v;
-            v.reserve(len);
+            std::pmr::vector<element_value> v = arena(clazz);
+            v.reserve(bf.checked_count(len, 3));
             for (size_t i = 0; i < len; i++)
-                v.push_back(parse_element_value(clazz, bf));
-            value.value = v;
+                v.push_back(parse_element_value(clazz, bf, depth + 1));
+            value.value = std::move(v);
         }
             break;
         default:
@@ -504,24 +507,23 @@ namespace clazz
         return value;
     }
 
-    static annotation parse_annotation(const class_file& clazz, byte_file& bf)
+    static annotation parse_annotation(const class_file& clazz, byte_file& bf, size_t depth)
     {
-        annotation a;
-        a.type_index = utf8_ref{clazz, bf.read_u16()};
+        annotation a{utf8_ref{clazz, bf.read_u16()}, arena(clazz)};
         uint16_t len = bf.read_u16();
 
-        a.entries.reserve(len);
+        a.entries.reserve(bf.checked_count(len, 5));
         for (size_t i = 0; i < len; i++)
-            a.entries.push_back({{clazz, bf.read_u16()}, parse_element_value(clazz, bf)});
+            a.entries.push_back({{clazz, bf.read_u16()}, parse_element_value(clazz, bf, depth)});
         return a;
     }
 
     static type_annotation parse_type_annotation(const class_file& clazz, byte_file& bf)
     {
-        type_annotation annotation{bf.read_u8()};
+        uint8_t target_type = bf.read_u8();
 
         type_annotation::target_info_t info;
-        switch (annotation.target_type)
+        switch (target_type)
         {
         case 0x00:
         case 0x01:
@@ -547,9 +549,9 @@ namespace clazz
             break;
         case 0x40:
         case 0x41: {
-            type_annotation::localvar_target target;
+            type_annotation::localvar_target target{arena(clazz)};
             uint16_t len = bf.read_u16();
-            target.table.reserve(len);
+            target.table.reserve(bf.checked_count(len, 6));
             for (size_t i = 0; i < len; i++)
                 target.table.push_back({bf.read_u16(), bf.read_u16(), bf.read_u16()});
             info = std::move(target);
@@ -575,11 +577,10 @@ namespace clazz
             throw class_parse_error("bad type annotation type");
         }
 
-        annotation.target_path = parse_type_path(clazz, bf);
-        annotation.type_index = { clazz, bf.read_u16() };
+        type_annotation annotation{target_type, std::move(info), parse_type_path(clazz, bf), {clazz, bf.read_u16()}, arena(clazz)};
 
         uint16_t len = bf.read_u16();
-        annotation.entries.reserve(len);
+        annotation.entries.reserve(bf.checked_count(len, 5));
         for (size_t i = 0; i < len; i++)
         {
             annotation.entries.push_back({
@@ -591,48 +592,75 @@ namespace clazz
         return annotation;
     }
 
-    template <typename T>
-    class raii_guard
+    struct lazy_attribute::state
     {
-        T v;
-
-    public:
-        raii_guard(T&& v) : v(v) {}
-        ~raii_guard()
-        {
-            if (!std::uncaught_exceptions())
-                v();
-        }
+        std::once_flag once;
+        std::optional<attribute> value;
+        bool compact_code;
     };
 
-    template <typename T>
-    raii_guard(T&& v) -> raii_guard<T>;
+    static std::string_view attribute_name(const class_file& clazz, utf8_ref name)
+    {
+        const auto& tmp = name.get(clazz).bytes;
+        return {(const char*)tmp.data(), tmp.size()};
+    }
 
-    static attribute parse_attribute(class_file& clazz, byte_file& bf, size_t index)
+    static bool is_deferrable(std::string_view name)
+    {
+        return name == "Code" || name == "StackMapTable" || name == "RuntimeInvisibleTypeAnnotations" ||
+               name == "RuntimeInvisibleParameterAnnotations" || name == "RuntimeInvisibleAnnotations" ||
+               name == "RuntimeVisibleTypeAnnotations" || name == "RuntimeVisibleParameterAnnotations" || name == "RuntimeVisibleAnnotations";
+    }
+
+    static attribute parse_attribute_body(class_file& clazz, byte_file& bf, utf8_ref name, uint32_t sz, size_t index,
+                                          const parse_options& options);
+
+    static attribute parse_attribute(class_file& clazz, byte_file& bf, size_t index, const parse_options& options)
     {
         auto name = utf8_ref(clazz, bf.read_u16());
-        const auto& tmp = name.get(clazz).bytes;
-        std::string str_name(tmp.begin(), tmp.end());
+        std::string_view str_name = attribute_name(clazz, name);
+        stats::count_attribute(str_name);
 
         uint32_t sz = bf.read_u32();
         size_t target = bf.get_cursor() + sz;
 
-        raii_guard g([&]() {
-            if (bf.get_cursor() != target)
-                throw std::runtime_error("internal IO fail: " + str_name);
-        });
+        if (options.lazy_attributes && is_deferrable(str_name))
+        {
+            auto bytes = bf.read_bytes(sz);
+            if (!options.borrow_input)
+            {
+                auto* copy = (uint8_t*)clazz.arena->allocate(sz, 1);
+                std::memcpy(copy, bytes.data(), sz);
+                bytes = {copy, sz};
+            }
+
+            auto data = std::allocate_shared<lazy_attribute::state>(std::pmr::polymorphic_allocator<lazy_attribute::state>(clazz.arena.get()));
+            data->compact_code = options.compact_code;
+            return lazy_attribute{name, bytes, std::move(data)};
+        }
+
+        auto attr = parse_attribute_body(clazz, bf, name, sz, index, options);
+        if (bf.get_cursor() != target)
+            throw class_parse_error("attribute length mismatch: " + std::string(str_name));
+        return attr;
+    }
+
+    static attribute parse_attribute_body(class_file& clazz, byte_file& bf, utf8_ref name, uint32_t sz, size_t index,
+                                          const parse_options& options)
+    {
+        std::string_view str_name = attribute_name(clazz, name);
 
         if (str_name == "Code")
-            return parse_code_attribute(clazz, bf);
+            return parse_code_attribute(clazz, bf, options);
         else if (str_name == "Signature")
             return signature_attribute{utf8_ref(clazz, bf.read_u16())};
         else if (str_name == "SourceFile")
             return source_file_attribute{utf8_ref(clazz, bf.read_u16())};
         else if (str_name == "LocalVariableTable")
         {
-            lvt_attribute attr;
+            lvt_attribute attr{arena(clazz)};
             uint16_t len = bf.read_u16();
-            attr.lvt.reserve(len);
+            attr.lvt.reserve(bf.checked_count(len, 10));
             for (size_t i = 0; i < len; i++)
             {
                 attr.lvt.push_back({
@@ -648,9 +676,9 @@ namespace clazz
         }
         else if (str_name == "LocalVariableTypeTable")
         {
-            lvt_type_attribute attr;
+            lvt_type_attribute attr{arena(clazz)};
             uint16_t len = bf.read_u16();
-            attr.lvt.reserve(len);
+            attr.lvt.reserve(bf.checked_count(len, 10));
             for (size_t i = 0; i < len; i++)
             {
                 attr.lvt.push_back({
@@ -666,9 +694,9 @@ namespace clazz
         }
         else if (str_name == "InnerClasses")
         {
-            inner_class_attribute attr;
+            inner_class_attribute attr{arena(clazz)};
             uint16_t len = bf.read_u16();
-            attr.inner_classes.reserve(len);
+            attr.inner_classes.reserve(bf.checked_count(len, 8));
             for (size_t i = 0; i < len; i++)
             {
                 attr.inner_classes.push_back({
@@ -682,9 +710,9 @@ namespace clazz
         }
         else if (str_name == "LineNumberTable")
         {
-            lineno_attribute attr;
+            lineno_attribute attr{arena(clazz)};
             uint16_t len = bf.read_u16();
-            attr.line_number_table.reserve(len);
+            attr.line_number_table.reserve(bf.checked_count(len, 4));
             for (size_t i = 0; i < len; i++)
             {
                 attr.line_number_table.push_back({
@@ -703,9 +731,9 @@ namespace clazz
         }
         else if (str_name == "NestMembers")
         {
-            nest_members_attribute attr;
+            nest_members_attribute attr{arena(clazz)};
             uint16_t len = bf.read_u16();
-            attr.classes.reserve(len);
+            attr.classes.reserve(bf.checked_count(len, 2));
             for (size_t i = 0; i < len; i++)
                 attr.classes.push_back(class_ref(clazz, bf.read_u16()));
             return attr;
@@ -716,9 +744,9 @@ namespace clazz
             return constant_value_attribute{primitive_ref(clazz, bf.read_u16())};
         else if (str_name == "Exceptions")
         {
-            exceptions_attribute attr;
+            exceptions_attribute attr{arena(clazz)};
             uint16_t len = bf.read_u16();
-            attr.exception_index_table.reserve(len);
+            attr.exception_index_table.reserve(bf.checked_count(len, 2));
             for (size_t i = 0; i < len; i++)
                 attr.exception_index_table.push_back(class_ref(clazz, bf.read_u16()));
             return attr;
@@ -729,23 +757,23 @@ namespace clazz
         }
         else if(str_name == "RuntimeInvisibleTypeAnnotations")
         {
-            runtime_invisible_type_annotations_attribute attr;
+            runtime_invisible_type_annotations_attribute attr{arena(clazz)};
             uint16_t len = bf.read_u16();
-            attr.annotations.reserve(len);
+            attr.annotations.reserve(bf.checked_count(len, 6));
             for(size_t i = 0; i < len; i++)
                 attr.annotations.push_back(parse_type_annotation(clazz,bf));
             return attr;
         }
         else if(str_name == "RuntimeInvisibleParameterAnnotations")
         {
-            runtime_invisible_parameter_annotations_attribute attr;
+            runtime_invisible_parameter_annotations_attribute attr{arena(clazz)};
             uint8_t len = bf.read_u8();
-            attr.annotations.reserve(len);
+            attr.annotations.reserve(bf.checked_count(len, 2));
             for(size_t i = 0; i < len; i++)
             {
                 uint16_t num_annotations = bf.read_u16();
-                std::vector<annotations::annotation> v;
-                v.reserve(num_annotations);
+                std::pmr::vector<annotations::annotation> v = arena(clazz);
+                v.reserve(bf.checked_count(num_annotations, 4));
                 for(size_t j = 0; j < num_annotations;j++)
                     v.push_back(parse_annotation(clazz,bf));
                 attr.annotations.emplace_back(std::move(v));
@@ -754,32 +782,32 @@ namespace clazz
         }
         else if(str_name == "RuntimeInvisibleAnnotations")
         {
-            runtime_invisible_annotations_attribute attr;
+            runtime_invisible_annotations_attribute attr{arena(clazz)};
             uint16_t len = bf.read_u16();
-            attr.annotations.reserve(len);
+            attr.annotations.reserve(bf.checked_count(len, 4));
             for(size_t i = 0; i < len; i++)
                     attr.annotations.push_back(parse_annotation(clazz,bf));
             return attr;
         }
         else if(str_name == "RuntimeVisibleTypeAnnotations")
         {
-            runtime_visible_type_annotations_attribute attr;
+            runtime_visible_type_annotations_attribute attr{arena(clazz)};
             uint16_t len = bf.read_u16();
-            attr.annotations.reserve(len);
+            attr.annotations.reserve(bf.checked_count(len, 6));
             for(size_t i = 0; i < len; i++)
                 attr.annotations.push_back(parse_type_annotation(clazz,bf));
             return attr;
         }
         else if(str_name == "RuntimeVisibleParameterAnnotations")
         {
-            runtime_visible_parameter_annotations_attribute attr;
+            runtime_visible_parameter_annotations_attribute attr{arena(clazz)};
             uint8_t len = bf.read_u8();
-            attr.annotations.reserve(len);
+            attr.annotations.reserve(bf.checked_count(len, 2));
             for(size_t i = 0; i < len; i++)
             {
                 uint16_t num_annotations = bf.read_u16();
-                std::vector<annotations::annotation> v;
-                v.reserve(num_annotations);
+                std::pmr::vector<annotations::annotation> v = arena(clazz);
+                v.reserve(bf.checked_count(num_annotations, 4));
                 for(size_t j = 0; j < num_annotations;j++)
                     v.push_back(parse_annotation(clazz,bf));
                 attr.annotations.emplace_back(std::move(v));
@@ -788,21 +816,41 @@ namespace clazz
         }
         else if(str_name == "RuntimeVisibleAnnotations")
         {
-            runtime_visible_annotations_attribute attr;
+            runtime_visible_annotations_attribute attr{arena(clazz)};
             uint16_t len = bf.read_u16();
-            attr.annotations.reserve(len);
+            attr.annotations.reserve(bf.checked_count(len, 4));
             for(size_t i = 0; i < len; i++)
                     attr.annotations.push_back(parse_annotation(clazz,bf));
             return attr;
         }
 
-        attribute_info info;
-        info.attribute_name_index = name;
-        for (size_t i = 0; i < sz; i++)
-            info.buffer.push_back(bf.read_u8());
+        attribute_info info{name, arena(clazz)};
+        auto bytes = bf.read_bytes(sz);
+        info.buffer.assign(bytes.begin(), bytes.end());
         return info;
     }
 
+    const attribute& resolve(const class_file& clazz, const attribute& attr)
+    {
+        const auto* lazy = std::get_if<lazy_attribute>(&attr);
+        if (!lazy)
+            return attr;
+
+        auto& state = *lazy->data;
+        std::call_once(state.once, [&] {
+            stats::scoped_phase timer(stats::phase::parse);
+            // the body is kept alive by the class, so nested lazy attributes can borrow from it. decoding only reads the
+            // constant pool and allocates from the arena, which is locked in lazy mode
+            parse_options options{.borrow_input = true, .compact_code = state.compact_code, .lazy_attributes = true};
+            byte_file bf(lazy->bytes);
+            auto value = parse_attribute_body(const_cast<class_file&>(clazz), bf, lazy->attribute_name_index, lazy->bytes.size(), 0, options);
+            if (bf.remaining())
+                throw class_parse_error("attribute length mismatch: " + std::string(attribute_name(clazz, lazy->attribute_name_index)));
+            state.value.emplace(std::move(value));
+        });
+        return *state.value;
+    }
+
     template <typename... Ts>
     struct overload : Ts...
     {
@@ -867,36 +915,38 @@ namespace clazz
         }
     }
 
-    class_file parse_class(const std::string& file)
+    static class_file parse_class(byte_file& bf, std::shared_ptr<std::pmr::memory_resource> resource, const parse_options& options)
     {
-        byte_file bf(file);
-        if (!bf.get_stream())
-            throw std::runtime_error("unable to open file");
-
-        class_file clazz;
+        stats::scoped_phase timer(stats::phase::parse);
+        stats::add(stats::counter::classes);
+        class_file clazz(std::move(resource));
         clazz.magic = bf.read_u32();
 
         if (clazz.magic != 0xcafebabe)
             throw class_parse_error("bad signature, expected 0xcafebabe");
         clazz.minor_version = bf.read_u16();
         clazz.major_version = bf.read_u16();
-        clazz.bootstrap_index = -1ull;
 
         uint16_t constant_pool_count = bf.read_u16();
-        clazz.constant_pool.reserve(constant_pool_count);
+        clazz.constant_pool.reserve(bf.checked_count(constant_pool_count, 3));
 
+        std::optional<stats::scoped_phase> cp_timer(stats::phase::constant_pool);
         for (size_t i = 1; i < constant_pool_count; i++)
         {
             uint8_t tag = bf.read_u8();
             switch (tag)
             {
             case 1: {
-                utf8_info info;
-                uint16_t len = bf.read_u16();
-                info.bytes.reserve(len);
-                for (int j = 0; j < len; j++)
-                    info.bytes.push_back(bf.read_u8());
-                clazz.constant_pool.push_back(info);
+                auto bytes = bf.read_bytes(bf.read_u16());
+                if (options.validate_utf8 && !is_valid_modified_utf8(bytes))
+                    throw class_parse_error("malformed utf8 constant at index " + std::to_string(i));
+                if (!options.borrow_input)
+                {
+                    auto* copy = (uint8_t*)clazz.arena->allocate(bytes.size(), 1);
+                    std::memcpy(copy, bytes.data(), bytes.size());
+                    bytes = {copy, bytes.size()};
+                }
+                clazz.constant_pool.push_back(utf8_info{bytes});
                 break;
             }
             case 3:
@@ -951,12 +1001,14 @@ namespace clazz
             }
         }
 
+        cp_timer.reset();
+
         clazz.access_flags = bf.read_u16();
         clazz.this_class = {clazz, bf.read_u16()};
         clazz.super_class = {clazz, bf.read_u16()};
 
         uint16_t interfaces_count = bf.read_u16();
-        clazz.interfaces.reserve(interfaces_count);
+        clazz.interfaces.reserve(bf.checked_count(interfaces_count, 2));
         for (int i = 0; i < interfaces_count; i++)
         {
             uint16_t ref = bf.read_u16();
@@ -964,41 +1016,196 @@ namespace clazz
         }
 
         uint16_t fields_count = bf.read_u16();
-        clazz.fields.reserve(fields_count);
+        clazz.fields.reserve(bf.checked_count(fields_count, 8));
         for (int i = 0; i < fields_count; i++)
         {
-            field_info info;
+            field_info info{0, {}, {}, arena(clazz)};
             info.access_flags = bf.read_u16();
             info.name_index = {clazz, bf.read_u16()};
             info.descriptor_index = {clazz, bf.read_u16()};
             uint16_t attributes_count = bf.read_u16();
-            info.attributes.reserve(attributes_count);
+            info.attributes.reserve(bf.checked_count(attributes_count, 6));
             for (size_t j = 0; j < attributes_count; j++)
-                info.attributes.push_back(parse_attribute(clazz, bf, 0));
-            clazz.fields.push_back(info);
+                info.attributes.push_back(parse_attribute(clazz, bf, 0, options));
+            clazz.fields.push_back(std::move(info));
         }
 
         uint16_t methods_count = bf.read_u16();
-        clazz.methods.reserve(fields_count);
+        clazz.methods.reserve(bf.checked_count(methods_count, 8));
         for (int i = 0; i < methods_count; i++)
         {
-            method_info info;
+            method_info info{0, {}, {}, arena(clazz)};
             info.access_flags = bf.read_u16();
             info.name_index = {clazz, bf.read_u16()};
             info.descriptor_index = {clazz, bf.read_u16()};
             uint16_t attributes_count = bf.read_u16();
-            info.attributes.reserve(attributes_count);
+            info.attributes.reserve(bf.checked_count(attributes_count, 6));
             for (size_t j = 0; j < attributes_count; j++)
-                info.attributes.push_back(parse_attribute(clazz, bf, 0));
-            clazz.methods.push_back(info);
+                info.attributes.push_back(parse_attribute(clazz, bf, 0, options));
+            clazz.methods.push_back(std::move(info));
         }
 
         uint16_t attributes_count = bf.read_u16();
-        clazz.attributes.reserve(attributes_count);
+        clazz.attributes.reserve(bf.checked_count(attributes_count, 6));
         for (size_t i = 0; i < attributes_count; i++)
-            clazz.attributes.push_back(parse_attribute(clazz, bf, i));
+            clazz.attributes.push_back(parse_attribute(clazz, bf, i, options));
 
-        validate_constant_pool(clazz);
+        {
+            stats::scoped_phase validate_timer(stats::phase::validate);
+            validate_constant_pool(clazz);
+        }
         return clazz;
     }
+
+    inst inst_view::decode(const class_file& clazz) const
+    {
+        inst res{size(), opcode()};
+        const uint8_t op = opcode();
+        const int32_t v = operand();
+
+        switch (opcode_table[op].kind)
+        {
+        case operand_kind::none:
+        case operand_kind::invalid:
+            break;
+        case operand_kind::immediate:
+            res.operand1 = (int)v;
+            break;
+        case operand_kind::constant:
+            if (op == 0x12)
+                res.operand1 = variant_cast(
+                    expand_ref<string_info, integer_info, float_info, class_info, method_type_info, method_handle_info>(clazz, v));
+            else
+                res.operand1 = variant_cast(
+                    expand_ref<string_info, integer_info, float_info, long_info, double_info, class_info, method_type_info, method_handle_info>(clazz,
+                                                                                                                                                v));
+            break;
+        case operand_kind::local:
+            res.operand1 = lvt_ref(v);
+            break;
+        case operand_kind::iinc:
+            res.operand1 = lvt_ref(v);
+            res.operand2 = (int)operand2();
+            break;
+        case operand_kind::branch:
+            res.operand1 = address_offset(v);
+            break;
+        case operand_kind::field:
+            res.operand1 = fieldref_ref(nocheck, v);
+            break;
+        case operand_kind::method:
+            if (op == 0xb8 && std::holds_alternative<interface_methodref_info>(clazz.constant_pool[v - 1]))
+                res.operand1 = interface_methodref_ref(nocheck, v);
+            else
+                res.operand1 = methodref_ref(nocheck, v);
+            break;
+        case operand_kind::interface_method:
+            res.operand1 = interface_methodref_ref(nocheck, v);
+            res.operand2 = (int)operand2();
+            break;
+        case operand_kind::invoke_dynamic:
+            res.operand1 = invoke_dynamic_ref(nocheck, v);
+            break;
+        case operand_kind::primitive_type:
+            res.operand1 = primitive_type_ref(v);
+            break;
+        case operand_kind::class_type:
+            res.operand1 = class_ref(nocheck, v);
+            break;
+        case operand_kind::multianewarray:
+            res.operand1 = class_ref(nocheck, v);
+            res.operand2 = (int)operand2();
+            break;
+        case operand_kind::wide:
+            res.special = wide_data{(uint8_t)side()[0]};
+            res.operand1 = lvt_ref(side()[1]);
+            if (opcode_table[side()[0]].kind == operand_kind::iinc)
+                res.operand2 = (int)operand2();
+            break;
+        case operand_kind::tableswitch: {
+            const int32_t* data = side();
+            tableswitch_data table{data[0], data[1], data[2], {}};
+            table.lut.assign(data + 3, data + 3 + ((int64_t)table.high - table.low + 1));
+            res.special = std::move(table);
+            break;
+        }
+        case operand_kind::lookupswitch: {
+            const int32_t* data = side();
+            lookupswitch_data table{data[0], {}};
+            table.lut.reserve(data[1]);
+            for (int32_t i = 0; i < data[1]; i++)
+                table.lut.push_back({data[2 + 2 * i], data[3 + 2 * i]});
+            res.special = std::move(table);
+            break;
+        }
+        }
+
+        return res;
+    }
+
+    // lazily parsed classes keep allocating from their arena after parse_class returns, possibly from several threads
+    class locked_resource : public std::pmr::memory_resource
+    {
+        std::shared_ptr<std::pmr::memory_resource> upstream;
+        std::mutex lock;
+
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            std::lock_guard g(lock);
+            return upstream->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override
+        {
+            std::lock_guard g(lock);
+            upstream->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& rhs) const noexcept override { return this == &rhs; }
+
+    public:
+        inline locked_resource(std::shared_ptr<std::pmr::memory_resource> upstream) : upstream(std::move(upstream)) {}
+    };
+
+    class_file parse_class(std::span<const std::byte> data, const parse_options& options)
+    {
+        std::shared_ptr<std::pmr::memory_resource> arena;
+        if (options.arena)
+            arena = std::shared_ptr<std::pmr::memory_resource>(std::shared_ptr<void>(), options.arena);
+        else
+        {
+            // parsed classes take a small multiple of their file size, start there so most classes fit in one block
+            arena = std::make_shared<std::pmr::monotonic_buffer_resource>(std::max<size_t>(4096, data.size() * 2), stats::arena_upstream());
+        }
+
+        if (options.lazy_attributes)
+            arena = std::make_shared<locked_resource>(std::move(arena));
+
+        byte_file bf({(const uint8_t*)data.data(), data.size()});
+        auto clazz = parse_class(bf, std::move(arena), options);
+        clazz.input_owner = options.input_owner;
+        return clazz;
+    }
+
+    class_file parse_class(std::span<const std::byte> data, const std::string& source_name, const parse_options& options)
+    {
+        try
+        {
+            return parse_class(data, options);
+        }
+        catch (class_parse_error& e)
+        {
+            throw class_parse_error(source_name + ": " + e.what());
+        }
+    }
+
+    class_file parse_class(const std::string& file, const parse_options& options)
+    {
+        // the mapping is retained by the class, so constants can always be borrowed from it
+        auto mf = std::make_shared<mapped_file>(file);
+        parse_options opts = options;
+        opts.borrow_input = true;
+        opts.input_owner = mf;
+        return parse_class(std::as_bytes(mf->data()), opts);
+    }
 } // namespace clazz
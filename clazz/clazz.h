@@ -1,7 +1,14 @@
 // cSpell:ignore clazz
 #pragma once
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -158,9 +165,10 @@ namespace clazz
     static_assert(alignof(address_ref) == alignof(uint16_t));
     static_assert(alignof(lvt_ref) == alignof(uint16_t));
 
+    // modified utf-8 bytes, either borrowed from the class file buffer or copied into the arena of the class
     struct utf8_info
     {
-        std::vector<uint8_t> bytes;
+        std::span<const uint8_t> bytes;
     };
     using utf8_ref = cp_ref<utf8_info>;
 
@@ -328,13 +336,13 @@ namespace clazz
             struct append_frame
             {
                 uint16_t offset_delta;
-                std::vector<verification_type_info> locals;
+                std::pmr::vector<verification_type_info> locals;
             };
             struct full_frame
             {
                 uint16_t offset_delta;
-                std::vector<verification_type_info> locals;
-                std::vector<verification_type_info> stack;
+                std::pmr::vector<verification_type_info> locals;
+                std::pmr::vector<verification_type_info> stack;
             };
 
             std::variant<same_frame, same_locals_1_stack_item_frame, same_locals_1_stack_item_frame_extended, chop_frame, same_frame_extended,
@@ -353,14 +361,14 @@ namespace clazz
                 uint8_t type_argument_index;
             };
 
-            std::vector<entry> path;
+            std::pmr::vector<entry> path;
         };
 
         struct annotation
         {
             utf8_ref type_index;
             struct entry;
-            std::vector<entry> entries;
+            std::pmr::vector<entry> entries;
         };
 
         struct element_value
@@ -372,7 +380,7 @@ namespace clazz
             };
 
             uint8_t tag;
-            std::variant<integer_ref, double_ref, float_ref, long_ref, utf8_ref, enum_const_value, annotation, std::vector<element_value>> value;
+            std::variant<integer_ref, double_ref, float_ref, long_ref, utf8_ref, enum_const_value, annotation, std::pmr::vector<element_value>> value;
         };
 
         struct annotation::entry
@@ -422,7 +430,7 @@ namespace clazz
                     uint16_t index;
                 };
 
-                std::vector<target_entry> table;
+                std::pmr::vector<target_entry> table;
             };
 
             struct catch_target
@@ -448,13 +456,13 @@ namespace clazz
             target_info_t target_info;
             type_path target_path;
             utf8_ref type_index;
-            std::vector<std::pair<utf8_ref, element_value>> entries;
+            std::pmr::vector<std::pair<utf8_ref, element_value>> entries;
         };
     } // namespace annotations
     struct attribute_info
     {
         utf8_ref attribute_name_index;
-        std::vector<uint8_t> buffer;
+        std::pmr::vector<uint8_t> buffer;
     };
 
     struct signature_attribute
@@ -478,7 +486,7 @@ namespace clazz
             lvt_ref index;
         };
 
-        std::vector<lvt_entry> lvt;
+        std::pmr::vector<lvt_entry> lvt;
     };
 
     struct lvt_type_attribute
@@ -492,7 +500,7 @@ namespace clazz
             lvt_ref index;
         };
 
-        std::vector<lvt_type_entry> lvt;
+        std::pmr::vector<lvt_type_entry> lvt;
     };
 
     struct inner_class_attribute
@@ -504,7 +512,7 @@ namespace clazz
             nullable_cp_ref<utf8_info> inner_name_index;
             uint16_t inner_class_access_flags;
         };
-        std::vector<inner_class_entry> inner_classes;
+        std::pmr::vector<inner_class_entry> inner_classes;
     };
 
     struct lineno_attribute
@@ -514,12 +522,12 @@ namespace clazz
             address_ref start_pc;
             uint16_t line_number;
         };
-        std::vector<lineno_entry> line_number_table;
+        std::pmr::vector<lineno_entry> line_number_table;
     };
 
     struct stack_map_table_attribute
     {
-        std::vector<stackmap::stack_map_frame> entries;
+        std::pmr::vector<stackmap::stack_map_frame> entries;
     };
 
     struct bootstrap_methods_attribute
@@ -527,15 +535,15 @@ namespace clazz
         struct bootstrap_methods_entry
         {
             method_handle_ref bootstrap_method_ref;
-            std::vector<any_cp_ref> bootstrap_arguments;
+            std::pmr::vector<any_cp_ref> bootstrap_arguments;
         };
 
-        std::vector<bootstrap_methods_entry> bootstrap_methods;
+        std::pmr::vector<bootstrap_methods_entry> bootstrap_methods;
     };
 
     struct nest_members_attribute
     {
-        std::vector<class_ref> classes;
+        std::pmr::vector<class_ref> classes;
     };
 
     struct nest_host_attribute
@@ -550,7 +558,7 @@ namespace clazz
 
     struct exceptions_attribute
     {
-        std::vector<class_ref> exception_index_table;
+        std::pmr::vector<class_ref> exception_index_table;
     };
 
     struct enclosing_method_attribute
@@ -561,38 +569,49 @@ namespace clazz
 
     struct runtime_invisible_type_annotations_attribute
     {
-        std::vector<annotations::type_annotation> annotations;
+        std::pmr::vector<annotations::type_annotation> annotations;
     };
 
     struct runtime_invisible_parameter_annotations_attribute
     {
-        std::vector<std::vector<annotations::annotation>> annotations;
+        std::pmr::vector<std::pmr::vector<annotations::annotation>> annotations;
     };
 
     struct runtime_invisible_annotations_attribute
     {
-        std::vector<annotations::annotation> annotations;
+        std::pmr::vector<annotations::annotation> annotations;
     };
 
     struct runtime_visible_type_annotations_attribute
     {
-        std::vector<annotations::type_annotation> annotations;
+        std::pmr::vector<annotations::type_annotation> annotations;
     };
 
     struct runtime_visible_parameter_annotations_attribute
     {
-        std::vector<std::vector<annotations::annotation>> annotations;
+        std::pmr::vector<std::pmr::vector<annotations::annotation>> annotations;
     };
 
     struct runtime_visible_annotations_attribute
     {
-        std::vector<annotations::annotation> annotations;
+        std::pmr::vector<annotations::annotation> annotations;
     };
 
 
+    // an attribute whose decoding is deferred until it is first resolved, see parse_options::lazy_attributes
+    struct lazy_attribute
+    {
+        struct state;
+
+        utf8_ref attribute_name_index;
+        // the attribute body, without the name and length header
+        std::span<const uint8_t> bytes;
+        std::shared_ptr<state> data;
+    };
+
     struct code_attribute;
     using attribute =
-        std::variant<attribute_info, code_attribute, signature_attribute, source_file_attribute, lvt_attribute, inner_class_attribute,
+        std::variant<attribute_info, lazy_attribute, code_attribute, signature_attribute, source_file_attribute, lvt_attribute, inner_class_attribute,
                      lineno_attribute, stack_map_table_attribute, bootstrap_methods_attribute, lvt_type_attribute, nest_members_attribute,
                      nest_host_attribute, constant_value_attribute, exceptions_attribute, enclosing_method_attribute,
                          runtime_invisible_type_annotations_attribute, runtime_invisible_parameter_annotations_attribute,
@@ -600,44 +619,290 @@ namespace clazz
 runtime_visible_parameter_annotations_attribute, runtime_visible_annotations_attribute
                          >;
 
-    inline constexpr const char* opcodes[] = {
-        "nop",           "aconst_null", "iconst_m1",     "iconst_0",      "iconst_1",     "iconst_2",
-        "iconst_3",      "iconst_4",    "iconst_5",      "lconst_0",      "lconst_1",     "fconst_0",
-        "fconst_1",      "fconst_2",    "dconst_0",      "dconst_1",      "bipush",       "sipush",
-        "ldc",           "ldc_w",       "ldc2_w",        "iload",         "lload",        "fload",
-        "dload",         "aload",       "iload_0",       "iload_1",       "iload_2",      "iload_3",
-        "lload_0",       "lload_1",     "lload_2",       "lload_3",       "fload_0",      "fload_1",
-        "fload_2",       "fload_3",     "dload_0",       "dload_1",       "dload_2",      "dload_3",
-        "aload_0",       "aload_1",     "aload_2",       "aload_3",       "iaload",       "laload",
-        "faload",        "daload",      "aaload",        "baload",        "caload",       "saload",
-        "istore",        "lstore",      "fstore",        "dstore",        "astore",       "istore_0",
-        "istore_1",      "istore_2",    "istore_3",      "lstore_0",      "lstore_1",     "lstore_2",
-        "lstore_3",      "fstore_0",    "fstore_1",      "fstore_2",      "fstore_3",     "dstore_0",
-        "dstore_1",      "dstore_2",    "dstore_3",      "astore_0",      "astore_1",     "astore_2",
-        "astore_3",      "iastore",     "lastore",       "fastore",       "dastore",      "aastore",
-        "bastore",       "castore",     "sastore",       "pop",           "pop2",         "dup",
-        "dup_x1",        "dup_x2",      "dup2",          "dup2_x1",       "dup2_x2",      "swap",
-        "iadd",          "ladd",        "fadd",          "dadd",          "isub",         "lsub",
-        "fsub",          "dsub",        "imul",          "lmul",          "fmul",         "dmul",
-        "idiv",          "ldiv",        "fdiv",          "ddiv",          "irem",         "lrem",
-        "frem",          "drem",        "ineg",          "lneg",          "fneg",         "dneg",
-        "ishl",          "lshl",        "ishr",          "lshr",          "iushr",        "lushr",
-        "iand",          "land",        "ior",           "lor",           "ixor",         "lxor",
-        "iinc",          "i2l",         "i2f",           "i2d",           "l2i",          "l2f",
-        "l2d",           "f2i",         "f2l",           "f2d",           "d2i",          "d2l",
-        "d2f",           "i2b",         "i2c",           "i2s",           "lcmp",         "fcmpl",
-        "fcmpg",         "dcmpl",       "dcmpg",         "ifeq",          "ifne",         "iflt",
-        "ifge",          "ifgt",        "ifle",          "if_icmpeq",     "if_icmpne",    "if_icmplt",
-        "if_icmpge",     "if_icmpgt",   "if_icmple",     "if_acmpeq",     "if_acmpne",    "goto",
-        "jsr",           "ret",         "tableswitch",   "lookupswitch",  "ireturn",      "lreturn",
-        "freturn",       "dreturn",     "areturn",       "return",        "getstatic",    "putstatic",
-        "getfield",      "putfield",    "invokevirtual", "invokespecial", "invokestatic", "invokeinterface",
-        "invokedynamic", "new",         "newarray",      "anewarray",     "arraylength",  "athrow",
-        "checkcast",     "instanceof",  "monitorenter",  "monitorexit",   "wide",         "multianewarray",
-        "ifnull",        "ifnonnull",   "goto_w",        "jsr_w",         "breakpoint",
+    enum class operand_kind : uint8_t
+    {
+        none,
+        // bipush/sipush, width follows from the length
+        immediate,
+        // ldc family, u1 or u2 constant pool index
+        constant,
+        // u1 local variable index
+        local,
+        iinc,
+        // s2 or s4 branch offset
+        branch,
+        field,
+        method,
+        interface_method,
+        invoke_dynamic,
+        primitive_type,
+        class_type,
+        multianewarray,
+        tableswitch,
+        lookupswitch,
+        wide,
+        invalid,
     };
 
+    // stack effect that depends on a descriptor or operand rather than the opcode alone
+    inline constexpr int8_t STACK_VARIES = -1;
+
+    struct opcode_info
+    {
+        const char* name;
+        operand_kind kind;
+        // encoded length including the opcode, 0 for switches and wide
+        uint8_t length;
+        // operand stack slots popped and pushed, long and double take two
+        int8_t pops;
+        int8_t pushes;
+
+        constexpr bool valid() const { return kind != operand_kind::invalid; }
+    };
+
+    // one entry per opcode, the parser, printer and any other tool that needs instruction lengths go through this
+    inline constexpr std::array<opcode_info, 256> opcode_table = [] {
+        using enum operand_kind;
+        constexpr opcode_info defined[] = {
+            {"nop",              none,              1, 0, 0}, // 0x00
+            {"aconst_null",      none,              1, 0, 1}, // 0x01
+            {"iconst_m1",        none,              1, 0, 1}, // 0x02
+            {"iconst_0",         none,              1, 0, 1}, // 0x03
+            {"iconst_1",         none,              1, 0, 1}, // 0x04
+            {"iconst_2",         none,              1, 0, 1}, // 0x05
+            {"iconst_3",         none,              1, 0, 1}, // 0x06
+            {"iconst_4",         none,              1, 0, 1}, // 0x07
+            {"iconst_5",         none,              1, 0, 1}, // 0x08
+            {"lconst_0",         none,              1, 0, 2}, // 0x09
+            {"lconst_1",         none,              1, 0, 2}, // 0x0a
+            {"fconst_0",         none,              1, 0, 1}, // 0x0b
+            {"fconst_1",         none,              1, 0, 1}, // 0x0c
+            {"fconst_2",         none,              1, 0, 1}, // 0x0d
+            {"dconst_0",         none,              1, 0, 2}, // 0x0e
+            {"dconst_1",         none,              1, 0, 2}, // 0x0f
+            {"bipush",           immediate,         2, 0, 1}, // 0x10
+            {"sipush",           immediate,         3, 0, 1}, // 0x11
+            {"ldc",              constant,          2, 0, 1}, // 0x12
+            {"ldc_w",            constant,          3, 0, 1}, // 0x13
+            {"ldc2_w",           constant,          3, 0, 2}, // 0x14
+            {"iload",            local,             2, 0, 1}, // 0x15
+            {"lload",            local,             2, 0, 2}, // 0x16
+            {"fload",            local,             2, 0, 1}, // 0x17
+            {"dload",            local,             2, 0, 2}, // 0x18
+            {"aload",            local,             2, 0, 1}, // 0x19
+            {"iload_0",          none,              1, 0, 1}, // 0x1a
+            {"iload_1",          none,              1, 0, 1}, // 0x1b
+            {"iload_2",          none,              1, 0, 1}, // 0x1c
+            {"iload_3",          none,              1, 0, 1}, // 0x1d
+            {"lload_0",          none,              1, 0, 2}, // 0x1e
+            {"lload_1",          none,              1, 0, 2}, // 0x1f
+            {"lload_2",          none,              1, 0, 2}, // 0x20
+            {"lload_3",          none,              1, 0, 2}, // 0x21
+            {"fload_0",          none,              1, 0, 1}, // 0x22
+            {"fload_1",          none,              1, 0, 1}, // 0x23
+            {"fload_2",          none,              1, 0, 1}, // 0x24
+            {"fload_3",          none,              1, 0, 1}, // 0x25
+            {"dload_0",          none,              1, 0, 2}, // 0x26
+            {"dload_1",          none,              1, 0, 2}, // 0x27
+            {"dload_2",          none,              1, 0, 2}, // 0x28
+            {"dload_3",          none,              1, 0, 2}, // 0x29
+            {"aload_0",          none,              1, 0, 1}, // 0x2a
+            {"aload_1",          none,              1, 0, 1}, // 0x2b
+            {"aload_2",          none,              1, 0, 1}, // 0x2c
+            {"aload_3",          none,              1, 0, 1}, // 0x2d
+            {"iaload",           none,              1, 2, 1}, // 0x2e
+            {"laload",           none,              1, 2, 2}, // 0x2f
+            {"faload",           none,              1, 2, 1}, // 0x30
+            {"daload",           none,              1, 2, 2}, // 0x31
+            {"aaload",           none,              1, 2, 1}, // 0x32
+            {"baload",           none,              1, 2, 1}, // 0x33
+            {"caload",           none,              1, 2, 1}, // 0x34
+            {"saload",           none,              1, 2, 1}, // 0x35
+            {"istore",           local,             2, 1, 0}, // 0x36
+            {"lstore",           local,             2, 2, 0}, // 0x37
+            {"fstore",           local,             2, 1, 0}, // 0x38
+            {"dstore",           local,             2, 2, 0}, // 0x39
+            {"astore",           local,             2, 1, 0}, // 0x3a
+            {"istore_0",         none,              1, 1, 0}, // 0x3b
+            {"istore_1",         none,              1, 1, 0}, // 0x3c
+            {"istore_2",         none,              1, 1, 0}, // 0x3d
+            {"istore_3",         none,              1, 1, 0}, // 0x3e
+            {"lstore_0",         none,              1, 2, 0}, // 0x3f
+            {"lstore_1",         none,              1, 2, 0}, // 0x40
+            {"lstore_2",         none,              1, 2, 0}, // 0x41
+            {"lstore_3",         none,              1, 2, 0}, // 0x42
+            {"fstore_0",         none,              1, 1, 0}, // 0x43
+            {"fstore_1",         none,              1, 1, 0}, // 0x44
+            {"fstore_2",         none,              1, 1, 0}, // 0x45
+            {"fstore_3",         none,              1, 1, 0}, // 0x46
+            {"dstore_0",         none,              1, 2, 0}, // 0x47
+            {"dstore_1",         none,              1, 2, 0}, // 0x48
+            {"dstore_2",         none,              1, 2, 0}, // 0x49
+            {"dstore_3",         none,              1, 2, 0}, // 0x4a
+            {"astore_0",         none,              1, 1, 0}, // 0x4b
+            {"astore_1",         none,              1, 1, 0}, // 0x4c
+            {"astore_2",         none,              1, 1, 0}, // 0x4d
+            {"astore_3",         none,              1, 1, 0}, // 0x4e
+            {"iastore",          none,              1, 3, 0}, // 0x4f
+            {"lastore",          none,              1, 4, 0}, // 0x50
+            {"fastore",          none,              1, 3, 0}, // 0x51
+            {"dastore",          none,              1, 4, 0}, // 0x52
+            {"aastore",          none,              1, 3, 0}, // 0x53
+            {"bastore",          none,              1, 3, 0}, // 0x54
+            {"castore",          none,              1, 3, 0}, // 0x55
+            {"sastore",          none,              1, 3, 0}, // 0x56
+            {"pop",              none,              1, 1, 0}, // 0x57
+            {"pop2",             none,              1, 2, 0}, // 0x58
+            {"dup",              none,              1, 1, 2}, // 0x59
+            {"dup_x1",           none,              1, 2, 3}, // 0x5a
+            {"dup_x2",           none,              1, 3, 4}, // 0x5b
+            {"dup2",             none,              1, 2, 4}, // 0x5c
+            {"dup2_x1",          none,              1, 3, 5}, // 0x5d
+            {"dup2_x2",          none,              1, 4, 6}, // 0x5e
+            {"swap",             none,              1, 2, 2}, // 0x5f
+            {"iadd",             none,              1, 2, 1}, // 0x60
+            {"ladd",             none,              1, 4, 2}, // 0x61
+            {"fadd",             none,              1, 2, 1}, // 0x62
+            {"dadd",             none,              1, 4, 2}, // 0x63
+            {"isub",             none,              1, 2, 1}, // 0x64
+            {"lsub",             none,              1, 4, 2}, // 0x65
+            {"fsub",             none,              1, 2, 1}, // 0x66
+            {"dsub",             none,              1, 4, 2}, // 0x67
+            {"imul",             none,              1, 2, 1}, // 0x68
+            {"lmul",             none,              1, 4, 2}, // 0x69
+            {"fmul",             none,              1, 2, 1}, // 0x6a
+            {"dmul",             none,              1, 4, 2}, // 0x6b
+            {"idiv",             none,              1, 2, 1}, // 0x6c
+            {"ldiv",             none,              1, 4, 2}, // 0x6d
+            {"fdiv",             none,              1, 2, 1}, // 0x6e
+            {"ddiv",             none,              1, 4, 2}, // 0x6f
+            {"irem",             none,              1, 2, 1}, // 0x70
+            {"lrem",             none,              1, 4, 2}, // 0x71
+            {"frem",             none,              1, 2, 1}, // 0x72
+            {"drem",             none,              1, 4, 2}, // 0x73
+            {"ineg",             none,              1, 1, 1}, // 0x74
+            {"lneg",             none,              1, 2, 2}, // 0x75
+            {"fneg",             none,              1, 1, 1}, // 0x76
+            {"dneg",             none,              1, 2, 2}, // 0x77
+            {"ishl",             none,              1, 2, 1}, // 0x78
+            {"lshl",             none,              1, 3, 2}, // 0x79
+            {"ishr",             none,              1, 2, 1}, // 0x7a
+            {"lshr",             none,              1, 3, 2}, // 0x7b
+            {"iushr",            none,              1, 2, 1}, // 0x7c
+            {"lushr",            none,              1, 3, 2}, // 0x7d
+            {"iand",             none,              1, 2, 1}, // 0x7e
+            {"land",             none,              1, 4, 2}, // 0x7f
+            {"ior",              none,              1, 2, 1}, // 0x80
+            {"lor",              none,              1, 4, 2}, // 0x81
+            {"ixor",             none,              1, 2, 1}, // 0x82
+            {"lxor",             none,              1, 4, 2}, // 0x83
+            {"iinc",             iinc,              3, 0, 0}, // 0x84
+            {"i2l",              none,              1, 1, 2}, // 0x85
+            {"i2f",              none,              1, 1, 1}, // 0x86
+            {"i2d",              none,              1, 1, 2}, // 0x87
+            {"l2i",              none,              1, 2, 1}, // 0x88
+            {"l2f",              none,              1, 2, 1}, // 0x89
+            {"l2d",              none,              1, 2, 2}, // 0x8a
+            {"f2i",              none,              1, 1, 1}, // 0x8b
+            {"f2l",              none,              1, 1, 2}, // 0x8c
+            {"f2d",              none,              1, 1, 2}, // 0x8d
+            {"d2i",              none,              1, 2, 1}, // 0x8e
+            {"d2l",              none,              1, 2, 2}, // 0x8f
+            {"d2f",              none,              1, 2, 1}, // 0x90
+            {"i2b",              none,              1, 1, 1}, // 0x91
+            {"i2c",              none,              1, 1, 1}, // 0x92
+            {"i2s",              none,              1, 1, 1}, // 0x93
+            {"lcmp",             none,              1, 4, 1}, // 0x94
+            {"fcmpl",            none,              1, 2, 1}, // 0x95
+            {"fcmpg",            none,              1, 2, 1}, // 0x96
+            {"dcmpl",            none,              1, 4, 1}, // 0x97
+            {"dcmpg",            none,              1, 4, 1}, // 0x98
+            {"ifeq",             branch,            3, 1, 0}, // 0x99
+            {"ifne",             branch,            3, 1, 0}, // 0x9a
+            {"iflt",             branch,            3, 1, 0}, // 0x9b
+            {"ifge",             branch,            3, 1, 0}, // 0x9c
+            {"ifgt",             branch,            3, 1, 0}, // 0x9d
+            {"ifle",             branch,            3, 1, 0}, // 0x9e
+            {"if_icmpeq",        branch,            3, 2, 0}, // 0x9f
+            {"if_icmpne",        branch,            3, 2, 0}, // 0xa0
+            {"if_icmplt",        branch,            3, 2, 0}, // 0xa1
+            {"if_icmpge",        branch,            3, 2, 0}, // 0xa2
+            {"if_icmpgt",        branch,            3, 2, 0}, // 0xa3
+            {"if_icmple",        branch,            3, 2, 0}, // 0xa4
+            {"if_acmpeq",        branch,            3, 2, 0}, // 0xa5
+            {"if_acmpne",        branch,            3, 2, 0}, // 0xa6
+            {"goto",             branch,            3, 0, 0}, // 0xa7
+            {"jsr",              branch,            3, 0, 1}, // 0xa8
+            {"ret",              local,             2, 0, 0}, // 0xa9
+            {"tableswitch",      tableswitch,       0, 1, 0}, // 0xaa
+            {"lookupswitch",     lookupswitch,      0, 1, 0}, // 0xab
+            {"ireturn",          none,              1, 1, 0}, // 0xac
+            {"lreturn",          none,              1, 2, 0}, // 0xad
+            {"freturn",          none,              1, 1, 0}, // 0xae
+            {"dreturn",          none,              1, 2, 0}, // 0xaf
+            {"areturn",          none,              1, 1, 0}, // 0xb0
+            {"return",           none,              1, 0, 0}, // 0xb1
+            {"getstatic",        field,             3, STACK_VARIES, STACK_VARIES}, // 0xb2
+            {"putstatic",        field,             3, STACK_VARIES, STACK_VARIES}, // 0xb3
+            {"getfield",         field,             3, STACK_VARIES, STACK_VARIES}, // 0xb4
+            {"putfield",         field,             3, STACK_VARIES, STACK_VARIES}, // 0xb5
+            {"invokevirtual",    method,            3, STACK_VARIES, STACK_VARIES}, // 0xb6
+            {"invokespecial",    method,            3, STACK_VARIES, STACK_VARIES}, // 0xb7
+            {"invokestatic",     method,            3, STACK_VARIES, STACK_VARIES}, // 0xb8
+            {"invokeinterface",  interface_method,  5, STACK_VARIES, STACK_VARIES}, // 0xb9
+            {"invokedynamic",    invoke_dynamic,    5, STACK_VARIES, STACK_VARIES}, // 0xba
+            {"new",              class_type,        3, 0, 1}, // 0xbb
+            {"newarray",         primitive_type,    2, 1, 1}, // 0xbc
+            {"anewarray",        class_type,        3, 1, 1}, // 0xbd
+            {"arraylength",      none,              1, 1, 1}, // 0xbe
+            {"athrow",           none,              1, 1, 0}, // 0xbf
+            {"checkcast",        class_type,        3, 1, 1}, // 0xc0
+            {"instanceof",       class_type,        3, 1, 1}, // 0xc1
+            {"monitorenter",     none,              1, 1, 0}, // 0xc2
+            {"monitorexit",      none,              1, 1, 0}, // 0xc3
+            {"wide",             wide,              0, STACK_VARIES, STACK_VARIES}, // 0xc4
+            {"multianewarray",   multianewarray,    4, STACK_VARIES, 1}, // 0xc5
+            {"ifnull",           branch,            3, 1, 0}, // 0xc6
+            {"ifnonnull",        branch,            3, 1, 0}, // 0xc7
+            {"goto_w",           branch,            5, 0, 0}, // 0xc8
+            {"jsr_w",            branch,            5, 0, 1}, // 0xc9
+            {"breakpoint",       none,              1, 0, 0}, // 0xca
+        };
+        static_assert(std::size(defined) == 0xcb);
+
+        std::array<opcode_info, 256> table;
+        table.fill({"<bad opcode>", invalid, 1, 0, 0});
+        for (size_t i = 0; i < std::size(defined); i++)
+            table[i] = defined[i];
+        return table;
+    }();
+
     struct inst;
+    class inst_view;
+
+    // struct-of-arrays form of a method body: the per-instruction arrays are indexed by instruction number, and switch
+    // tables and wide instructions are stored out of line in `side`. operands are kept raw, their meaning follows from
+    // the opcode (see inst_view::decode)
+    struct compact_code
+    {
+        std::pmr::vector<uint8_t> opcodes;
+        // start ip of every instruction, plus a trailing entry holding the code length
+        std::pmr::vector<uint32_t> ips;
+        // constant pool index, local index, branch offset or immediate; index into `side` for switches and wide
+        std::pmr::vector<int32_t> operands;
+        // iinc delta, invokeinterface count or multianewarray dimensions
+        std::pmr::vector<int16_t> operands2;
+        // tableswitch: def, low, high, offsets...
+        // lookupswitch: def, npairs, (match, offset)...
+        // wide: real opcode, local index
+        std::pmr::vector<int32_t> side;
+
+        class iterator;
+        iterator begin() const;
+        iterator end() const;
+        constexpr size_t size() const { return opcodes.size(); }
+        constexpr bool empty() const { return opcodes.empty(); }
+    };
 
     struct code_attribute
     {
@@ -652,9 +917,11 @@ runtime_visible_parameter_annotations_attribute, runtime_visible_annotations_att
         uint16_t max_stack;
         uint16_t max_locals;
         std::size_t max_ip;
-        std::vector<inst> code;
-        std::vector<exception_table_entry> exception_table;
-        std::vector<attribute> attributes;
+        // decoded instructions; empty if the class was parsed with parse_options::compact_code, see `compact` instead
+        std::pmr::vector<inst> code;
+        std::pmr::vector<exception_table_entry> exception_table;
+        std::pmr::vector<attribute> attributes;
+        compact_code compact;
     };
 
     struct field_info
@@ -662,7 +929,7 @@ runtime_visible_parameter_annotations_attribute, runtime_visible_annotations_att
         uint16_t access_flags;
         utf8_ref name_index;
         utf8_ref descriptor_index;
-        std::vector<attribute> attributes;
+        std::pmr::vector<attribute> attributes;
     };
 
     struct method_info
@@ -671,23 +938,37 @@ runtime_visible_parameter_annotations_attribute, runtime_visible_annotations_att
         utf8_ref name_index;
         utf8_ref descriptor_index;
 
-        std::vector<attribute> attributes;
+        std::pmr::vector<attribute> attributes;
     };
 
     struct class_file
     {
+        // every container below is allocated from this arena, which is released in one go with the class.
+        // declared first so that it outlives the containers during destruction
+        std::shared_ptr<std::pmr::memory_resource> arena;
+        // keeps the input buffer alive when constants are borrowed from it
+        std::shared_ptr<const void> input_owner;
+
         uint32_t magic;
         uint16_t minor_version;
         uint16_t major_version;
-        std::vector<cp_info> constant_pool;
+        std::pmr::vector<cp_info> constant_pool;
         uint16_t access_flags;
         class_ref this_class;
         class_ref super_class;
-        std::vector<class_ref> interfaces;
-        std::vector<field_info> fields;
-        std::vector<method_info> methods;
-        std::vector<attribute> attributes;
+        std::pmr::vector<class_ref> interfaces;
+        std::pmr::vector<field_info> fields;
+        std::pmr::vector<method_info> methods;
+        std::pmr::vector<attribute> attributes;
         size_t bootstrap_index;
+
+        class_file() = default;
+        inline class_file(std::shared_ptr<std::pmr::memory_resource> arena)
+            : arena(std::move(arena)), magic(0), minor_version(0), major_version(0), constant_pool(this->arena.get()), access_flags(0),
+              interfaces(this->arena.get()), fields(this->arena.get()), methods(this->arena.get()), attributes(this->arena.get()),
+              bootstrap_index(-1ull)
+        {
+        }
     };
 
     namespace detail
@@ -781,13 +1062,13 @@ runtime_visible_parameter_annotations_attribute, runtime_visible_annotations_att
         address_offset def;
         int32_t low;
         int32_t high;
-        std::vector<address_offset> lut;
+        std::pmr::vector<address_offset> lut;
     };
 
     struct lookupswitch_data
     {
         address_offset def;
-        std::vector<std::pair<int32_t, address_offset>> lut;
+        std::pmr::vector<std::pair<int32_t, address_offset>> lut;
     };
 
     struct wide_data
@@ -805,16 +1086,181 @@ runtime_visible_parameter_annotations_attribute, runtime_visible_annotations_att
 
         using special_data = std::variant<std::monostate, tableswitch_data, wide_data, lookupswitch_data>;
 
-        uint8_t inst_sz;
+        uint32_t inst_sz;
         uint8_t opcode;
         special_data special;
         operand_1_t operand1;
         operand_2_t operand2;
     };
 
+    // a single instruction of a compact_code
+    class inst_view
+    {
+        const compact_code* code;
+        size_t index;
+
+    public:
+        constexpr inst_view(const compact_code& code, size_t index) : code(&code), index(index) {}
+
+        constexpr uint8_t opcode() const { return code->opcodes[index]; }
+        constexpr uint32_t ip() const { return code->ips[index]; }
+        constexpr uint32_t size() const { return code->ips[index + 1] - code->ips[index]; }
+        constexpr int32_t operand() const { return code->operands[index]; }
+        constexpr int16_t operand2() const { return code->operands2[index]; }
+        constexpr size_t get_index() const { return index; }
+
+        // out of line data of switches and wide, starting at this instruction's entry
+        constexpr const int32_t* side() const { return code->side.data() + operand(); }
+
+        // rebuilds the full instruction; switch tables are allocated from the default resource
+        inst decode(const class_file& clazz) const;
+    };
+
+    class compact_code::iterator
+    {
+        const compact_code* code;
+        size_t index;
+
+    public:
+        using value_type = inst_view;
+        using difference_type = std::ptrdiff_t;
+
+        constexpr iterator() : code(nullptr), index(0) {}
+        constexpr iterator(const compact_code& code, size_t index) : code(&code), index(index) {}
+
+        constexpr inst_view operator*() const { return {*code, index}; }
+        constexpr iterator& operator++()
+        {
+            index++;
+            return *this;
+        }
+        constexpr iterator operator++(int)
+        {
+            auto tmp = *this;
+            index++;
+            return tmp;
+        }
+        constexpr bool operator==(const iterator& rhs) const { return index == rhs.index; }
+    };
+
+    inline compact_code::iterator compact_code::begin() const { return {*this, 0}; }
+    inline compact_code::iterator compact_code::end() const { return {*this, size()}; }
+
+    // appends one decoded instruction starting at `ip` to a compact_code; the caller adds the trailing ips entry
+    void append_compact(compact_code& code, const inst& curr, size_t ip);
+
+    // operand1 the way compact_code stores it: constant pool or local index, branch offset, immediate or primitive type
+    int32_t raw_operand(const inst::operand_1_t& operand);
+
+    // calls f(ip, inst) for every instruction of a method body, whichever representation the parser produced
+    template <typename F>
+    void for_each_instruction(const class_file& clazz, const code_attribute& attr, F&& f)
+    {
+        if (attr.compact.empty())
+        {
+            size_t ip = 0;
+            for (const auto& i : attr.code)
+            {
+                f(ip, i);
+                ip += i.inst_sz;
+            }
+        }
+        else
+        {
+            for (auto i : attr.compact)
+                f(i.ip(), i.decode(clazz));
+        }
+    }
+
     inline static constexpr const char* METHOD_HANDLE_REF_TYPES[] = {
         nullptr,         "getField",     "getStatic",     "putField",         "putStatic",
         "invokeVirtual", "invokeStatic", "invokeSpecial", "newInvokeSpecial", "invokeInterface"};
 
-    class_file parse_class(const std::string& file);
+    struct parse_options
+    {
+        // allocate the class from a caller-owned arena (e.g. one per batch) instead of a fresh one per class. the
+        // resource must outlive the class and is not synchronised, so it must not be shared between threads
+        std::pmr::memory_resource* arena = nullptr;
+        // make utf8 constants views into the input instead of copying them. the input must outlive the class, either
+        // because the caller guarantees it or because input_owner keeps it alive
+        bool borrow_input = false;
+        std::shared_ptr<const void> input_owner;
+        // store method bodies as compact_code instead of a vector of inst
+        bool compact_code = false;
+        // keep Code, StackMapTable and annotation attributes as lazy_attribute and decode them on first resolve(). when
+        // the input is not borrowed their bytes are copied into the arena. a caller-provided arena is only locked per
+        // class, so lazily parsed classes sharing one must not be resolved concurrently
+        bool lazy_attributes = false;
+        // reject utf8 constants that are not well formed modified UTF-8, like the JVM does. off by default so that broken
+        // or obfuscated classes can still be dumped
+        bool validate_utf8 = false;
+    };
+
+    // class file name of a decoded attribute type
+    template <typename T>
+    constexpr const char* attribute_name()
+    {
+        if constexpr (std::is_same_v<T, code_attribute>)
+            return "Code";
+        else if constexpr (std::is_same_v<T, signature_attribute>)
+            return "Signature";
+        else if constexpr (std::is_same_v<T, source_file_attribute>)
+            return "SourceFile";
+        else if constexpr (std::is_same_v<T, lvt_attribute>)
+            return "LocalVariableTable";
+        else if constexpr (std::is_same_v<T, inner_class_attribute>)
+            return "InnerClasses";
+        else if constexpr (std::is_same_v<T, lineno_attribute>)
+            return "LineNumberTable";
+        else if constexpr (std::is_same_v<T, stack_map_table_attribute>)
+            return "StackMapTable";
+        else if constexpr (std::is_same_v<T, bootstrap_methods_attribute>)
+            return "BootstrapMethods";
+        else if constexpr (std::is_same_v<T, lvt_type_attribute>)
+            return "LocalVariableTypeTable";
+        else if constexpr (std::is_same_v<T, nest_members_attribute>)
+            return "NestMembers";
+        else if constexpr (std::is_same_v<T, nest_host_attribute>)
+            return "NestHost";
+        else if constexpr (std::is_same_v<T, constant_value_attribute>)
+            return "ConstantValue";
+        else if constexpr (std::is_same_v<T, exceptions_attribute>)
+            return "Exceptions";
+        else if constexpr (std::is_same_v<T, enclosing_method_attribute>)
+            return "EnclosingMethod";
+        else if constexpr (std::is_same_v<T, runtime_invisible_type_annotations_attribute>)
+            return "RuntimeInvisibleTypeAnnotations";
+        else if constexpr (std::is_same_v<T, runtime_invisible_parameter_annotations_attribute>)
+            return "RuntimeInvisibleParameterAnnotations";
+        else if constexpr (std::is_same_v<T, runtime_invisible_annotations_attribute>)
+            return "RuntimeInvisibleAnnotations";
+        else if constexpr (std::is_same_v<T, runtime_visible_type_annotations_attribute>)
+            return "RuntimeVisibleTypeAnnotations";
+        else if constexpr (std::is_same_v<T, runtime_visible_parameter_annotations_attribute>)
+            return "RuntimeVisibleParameterAnnotations";
+        else
+            return "RuntimeVisibleAnnotations";
+    }
+
+    // constant pool indices of attribute names, for writing decoded attributes back out. decoded attributes do not
+    // remember their name index, so each name is looked up once; 0 if the pool does not have it
+    class attribute_name_indices
+    {
+        const class_file& clazz;
+        std::vector<std::pair<std::string_view, uint16_t>> names;
+
+    public:
+        attribute_name_indices(const class_file& clazz) : clazz(clazz) {}
+
+        uint16_t operator()(std::string_view name);
+    };
+
+    // the decoded form of an attribute; lazy attributes are decoded on first call, which is safe to do concurrently.
+    // decoding errors of deferred attributes surface here rather than from parse_class
+    const attribute& resolve(const class_file& clazz, const attribute& attr);
+
+    class_file parse_class(const std::string& file, const parse_options& options = {});
+    class_file parse_class(std::span<const std::byte> data, const parse_options& options = {});
+    // same as above, but errors are prefixed with source_name (e.g. the archive entry the bytes came from)
+    class_file parse_class(std::span<const std::byte> data, const std::string& source_name, const parse_options& options = {});
 } // namespace clazz
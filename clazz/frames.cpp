@@ -0,0 +1,789 @@
+// cSpell:ignore clazz
+#include "frames.h"
+#include <algorithm>
+#include <bit>
+#include <string_view>
+
+namespace clazz
+{
+    namespace
+    {
+        constexpr uint32_t KINDS = 0xffff;
+        // a descriptor that could not be read
+        constexpr uint32_t BAD_KIND = ~0u;
+
+        constexpr uint32_t uninitialized(uint32_t new_ip) { return SLOT_UNINITIALIZED | new_ip << 16; }
+
+        // 0 is a slot no path has reached yet
+        constexpr uint32_t merge_slot(uint32_t a, uint32_t b)
+        {
+            if (a == b || !b)
+                return a;
+            if (!a)
+                return b;
+            // same kinds with different halves are objects from different `new`s, which do not mix
+            uint32_t kinds = (a | b) & KINDS;
+            return (a & KINDS) == (b & KINDS) ? kinds | SLOT_TOP : kinds;
+        }
+
+        constexpr int slot_size(uint32_t kind) { return kind == SLOT_LONG || kind == SLOT_DOUBLE ? 2 : 1; }
+
+        std::string kind_name(uint32_t slot)
+        {
+            switch (slot & KINDS)
+            {
+            case 0:
+                return "unset";
+            case SLOT_INT:
+                return "int";
+            case SLOT_FLOAT:
+                return "float";
+            case SLOT_LONG:
+                return "long";
+            case SLOT_DOUBLE:
+                return "double";
+            case SLOT_REFERENCE:
+                return "reference";
+            case SLOT_UNINITIALIZED_THIS:
+                return "uninitialized this";
+            case SLOT_UNINITIALIZED:
+                return "uninitialized @" + std::to_string(slot >> 16);
+            case SLOT_RETURN_ADDRESS:
+                return "return address";
+            default:
+                return "top";
+            }
+        }
+
+        // kind of the field type at desc[i], moving i past it. 0 for void
+        uint32_t field_kind(std::span<const uint8_t> desc, size_t& i)
+        {
+            if (i >= desc.size())
+                return BAD_KIND;
+            switch (desc[i++])
+            {
+            case 'B':
+            case 'C':
+            case 'I':
+            case 'S':
+            case 'Z':
+                return SLOT_INT;
+            case 'F':
+                return SLOT_FLOAT;
+            case 'J':
+                return SLOT_LONG;
+            case 'D':
+                return SLOT_DOUBLE;
+            case 'V':
+                return 0;
+            case 'L': {
+                auto end = std::find(desc.begin() + i, desc.end(), ';');
+                if (end == desc.end())
+                    return BAD_KIND;
+                i = end - desc.begin() + 1;
+                return SLOT_REFERENCE;
+            }
+            case '[': {
+                uint32_t element = field_kind(desc, i);
+                return element == BAD_KIND || element == 0 ? BAD_KIND : SLOT_REFERENCE;
+            }
+            default:
+                return BAD_KIND;
+            }
+        }
+
+        // calls f(kind) for every parameter of a method descriptor, then returns the kind of its return type
+        template <typename F>
+        uint32_t for_each_parameter(std::span<const uint8_t> desc, F&& f)
+        {
+            size_t i = 1;
+            if (desc.empty() || desc[0] != '(')
+                return BAD_KIND;
+            while (i < desc.size() && desc[i] != ')')
+            {
+                uint32_t kind = field_kind(desc, i);
+                if (kind == BAD_KIND || kind == 0)
+                    return BAD_KIND;
+                f(kind);
+            }
+            if (i++ >= desc.size())
+                return BAD_KIND;
+            uint32_t ret = field_kind(desc, i);
+            return i == desc.size() ? ret : BAD_KIND;
+        }
+
+        const name_and_type_info* member_type(const class_file& clazz, int32_t index)
+        {
+            if (index < 1 || (size_t)index > clazz.constant_pool.size())
+                return nullptr;
+            return std::visit(
+                [&]<typename T>(const T& info) -> const name_and_type_info* {
+                    if constexpr (is_member<T> || std::is_same_v<T, invoke_dynamic_info>)
+                        return &info.name_and_type_index.get(clazz);
+                    else
+                        return nullptr;
+                },
+                clazz.constant_pool[index - 1]);
+        }
+
+        uint32_t constant_kind(const class_file& clazz, int32_t index)
+        {
+            if (index < 1 || (size_t)index > clazz.constant_pool.size())
+                return BAD_KIND;
+            return std::visit(
+                []<typename T>(const T&) -> uint32_t {
+                    if constexpr (std::is_same_v<T, integer_info>)
+                        return SLOT_INT;
+                    else if constexpr (std::is_same_v<T, float_info>)
+                        return SLOT_FLOAT;
+                    else if constexpr (std::is_same_v<T, long_info>)
+                        return SLOT_LONG;
+                    else if constexpr (std::is_same_v<T, double_info>)
+                        return SLOT_DOUBLE;
+                    else if constexpr (detail::is_same_any<T, string_info, class_info, method_type_info, method_handle_info>)
+                        return SLOT_REFERENCE;
+                    else
+                        return BAD_KIND;
+                },
+                clazz.constant_pool[index - 1]);
+        }
+
+        // what a verification type expects of a slot, 0 for anything
+        uint32_t expected_kind(const stackmap::verification_type_info& info)
+        {
+            switch (info.tag)
+            {
+            case stackmap::VERIFICATION_INTEGER:
+                return SLOT_INT;
+            case stackmap::VERIFICATION_FLOAT:
+                return SLOT_FLOAT;
+            case stackmap::VERIFICATION_LONG:
+                return SLOT_LONG;
+            case stackmap::VERIFICATION_DOUBLE:
+                return SLOT_DOUBLE;
+            case stackmap::VERIFICATION_NULL:
+            case stackmap::VERIFICATION_OBJECT:
+                return SLOT_REFERENCE;
+            case stackmap::VERIFICATION_UNINITIALIZED_THIS:
+                return SLOT_UNINITIALIZED_THIS;
+            case stackmap::VERIFICATION_UNINITIALIZED:
+                return uninitialized(info.data);
+            default:
+                return 0;
+            }
+        }
+
+        // an instruction reduced to what the simulation needs; wide is replaced by the instruction it widens
+        struct raw_inst
+        {
+            uint32_t ip;
+            uint8_t opcode;
+            int32_t operand;
+            int16_t operand2;
+        };
+
+        // calls f(raw_inst) for the instructions numbered [first, last), the first of which starts at `ip`, until it
+        // returns false
+        template <typename F>
+        void for_each_raw(const code_attribute& code, uint32_t first, uint32_t last, uint32_t ip, F&& f)
+        {
+            if (code.compact.empty())
+            {
+                for (uint32_t i = first; i < last; i++)
+                {
+                    const inst& curr = code.code[i];
+                    const auto* wide = std::get_if<wide_data>(&curr.special);
+                    const int* operand2 = std::get_if<int>(&curr.operand2);
+                    if (!f(raw_inst{ip, wide ? wide->op : curr.opcode, raw_operand(curr.operand1), (int16_t)(operand2 ? *operand2 : 0)}))
+                        return;
+                    ip += curr.inst_sz;
+                }
+            }
+            else
+            {
+                for (uint32_t i = first; i < last; i++)
+                {
+                    inst_view curr(code.compact, i);
+                    bool wide = opcode_table[curr.opcode()].kind == operand_kind::wide;
+                    if (!f(raw_inst{curr.ip(), wide ? (uint8_t)curr.side()[0] : curr.opcode(), wide ? curr.side()[1] : curr.operand(),
+                                    curr.operand2()}))
+                        return;
+                }
+            }
+        }
+
+        // the interpreter, over a frame of max_locals locals followed by max_stack stack slots. only the first `tracked`
+        // locals are ever written, the rest stay top
+        class machine
+        {
+            const class_file& clazz;
+            uint32_t* locals;
+            uint32_t* stack;
+            uint16_t max_locals;
+            uint16_t tracked;
+            uint16_t max_stack;
+
+        public:
+            int32_t height = 0;
+            bool locals_changed = false;
+            std::string error;
+
+            machine(const class_file& clazz, uint32_t* frame, uint16_t max_locals, uint16_t tracked, uint16_t max_stack)
+                : clazz(clazz), locals(frame), stack(frame + max_locals), max_locals(max_locals), tracked(tracked), max_stack(max_stack)
+            {
+            }
+
+            bool fail(std::string message)
+            {
+                error = std::move(message);
+                return false;
+            }
+
+            bool pop(int slots)
+            {
+                if (height < slots)
+                    return fail("stack underflow, " + std::to_string(slots) + " slots needed but " + std::to_string(height) + " present");
+                height -= slots;
+                return true;
+            }
+
+            bool push(uint32_t kind)
+            {
+                int size = slot_size(kind);
+                if (height + size > max_stack)
+                    return fail("stack overflow, max_stack is " + std::to_string(max_stack));
+                stack[height++] = kind;
+                if (size == 2)
+                    stack[height++] = SLOT_TOP;
+                return true;
+            }
+
+            bool local_index(int32_t index, int size)
+            {
+                if (index < 0 || index + size > max_locals)
+                    return fail("local " + std::to_string(index) + " out of range, max_locals is " + std::to_string(max_locals));
+                return true;
+            }
+
+            bool load(int32_t index, uint32_t kind)
+            {
+                if (!local_index(index, slot_size(kind)))
+                    return false;
+                // references keep whatever the local holds, which may still be uninitialized
+                return push(kind == SLOT_REFERENCE ? locals[index] : kind);
+            }
+
+            bool store(int32_t index, int size)
+            {
+                if (!local_index(index, size) || !pop(size))
+                    return false;
+                // overwriting the second half of a long or double ruins the first
+                if (index > 0 && slot_size(locals[index - 1]) == 2)
+                    locals[index - 1] = SLOT_TOP;
+                locals[index] = stack[height];
+                if (size == 2)
+                    locals[index + 1] = SLOT_TOP;
+                locals_changed = true;
+                return true;
+            }
+
+            // copies the top `n` slots below the `x` slots under them, for the dup family
+            bool dup(int n, int x)
+            {
+                if (height < n + x)
+                    return fail("stack underflow, " + std::to_string(n + x) + " slots needed but " + std::to_string(height) + " present");
+                if (height + n > max_stack)
+                    return fail("stack overflow, max_stack is " + std::to_string(max_stack));
+                uint32_t top[2] = {stack[height - n], stack[height - 1]};
+                std::copy_backward(stack + height - n - x, stack + height, stack + height + n);
+                std::copy(top, top + n, stack + height - n - x);
+                height += n;
+                return true;
+            }
+
+            // after <init>, every copy of the object is initialized
+            void initialize(uint32_t object)
+            {
+                std::replace(locals, locals + tracked, object, (uint32_t)SLOT_REFERENCE);
+                std::replace(stack, stack + height, object, (uint32_t)SLOT_REFERENCE);
+                locals_changed = true;
+            }
+
+            bool invoke(const raw_inst& i)
+            {
+                const name_and_type_info* nat = member_type(clazz, i.operand);
+                if (!nat)
+                    return fail("invalid method reference");
+                int slots = i.opcode == 0xb8 || i.opcode == 0xba ? 0 : 1; // invokestatic, invokedynamic
+                uint32_t ret = for_each_parameter(nat->descriptor_index.get(clazz).bytes, [&](uint32_t kind) { slots += slot_size(kind); });
+                if (ret == BAD_KIND)
+                    return fail("malformed method descriptor");
+                if (!pop(slots))
+                    return false;
+
+                auto name = nat->name_index.get(clazz).bytes;
+                if (i.opcode == 0xb7 && std::string_view((const char*)name.data(), name.size()) == "<init>")
+                {
+                    uint32_t receiver = stack[height];
+                    if ((receiver & KINDS) == SLOT_UNINITIALIZED || receiver == SLOT_UNINITIALIZED_THIS)
+                        initialize(receiver);
+                }
+                return ret == 0 || push(ret);
+            }
+
+            bool field(const raw_inst& i)
+            {
+                const name_and_type_info* nat = member_type(clazz, i.operand);
+                if (!nat)
+                    return fail("invalid field reference");
+                auto desc = nat->descriptor_index.get(clazz).bytes;
+                size_t end = 0;
+                uint32_t kind = field_kind(desc, end);
+                if (kind == BAD_KIND || kind == 0 || end != desc.size())
+                    return fail("malformed field descriptor");
+
+                switch (i.opcode)
+                {
+                case 0xb2: // getstatic
+                    return push(kind);
+                case 0xb3: // putstatic
+                    return pop(slot_size(kind));
+                case 0xb4: // getfield
+                    return pop(1) && push(kind);
+                default: // putfield
+                    return pop(slot_size(kind) + 1);
+                }
+            }
+
+            bool execute(const raw_inst& i)
+            {
+                static constexpr uint32_t BY_TYPE[] = {SLOT_INT, SLOT_LONG, SLOT_FLOAT, SLOT_DOUBLE, SLOT_REFERENCE};
+                static constexpr uint32_t ARRAY_ELEMENTS[] = {SLOT_INT,       SLOT_LONG, SLOT_FLOAT, SLOT_DOUBLE,
+                                                              SLOT_REFERENCE, SLOT_INT,  SLOT_INT,   SLOT_INT};
+                static constexpr uint32_t CONVERSIONS[] = {SLOT_LONG, SLOT_FLOAT,  SLOT_DOUBLE, SLOT_INT, SLOT_FLOAT, SLOT_DOUBLE, SLOT_INT,
+                                                           SLOT_LONG, SLOT_DOUBLE, SLOT_INT,    SLOT_LONG, SLOT_FLOAT, SLOT_INT,    SLOT_INT,
+                                                           SLOT_INT};
+                const opcode_info& info = opcode_table[i.opcode];
+                uint8_t op = i.opcode;
+
+                if (op == 0x01) // aconst_null
+                    return push(SLOT_REFERENCE);
+                if (op >= 0x02 && op <= 0x11) // iconst_m1 to sipush
+                    return push(op <= 0x08 || op >= 0x10 ? SLOT_INT : op <= 0x0a ? SLOT_LONG : op <= 0x0d ? SLOT_FLOAT : SLOT_DOUBLE);
+                if (op >= 0x12 && op <= 0x14) // ldc, ldc_w, ldc2_w
+                {
+                    uint32_t kind = constant_kind(clazz, i.operand);
+                    if (kind == BAD_KIND || (slot_size(kind) == 2) != (op == 0x14))
+                        return fail("invalid constant for " + std::string(info.name));
+                    return push(kind);
+                }
+                if (op >= 0x15 && op <= 0x19) // iload to aload
+                    return load(i.operand, BY_TYPE[op - 0x15]);
+                if (op >= 0x1a && op <= 0x2d) // iload_0 to aload_3
+                    return load((op - 0x1a) % 4, BY_TYPE[(op - 0x1a) / 4]);
+                if (op >= 0x2e && op <= 0x35) // iaload to saload
+                    return pop(2) && push(ARRAY_ELEMENTS[op - 0x2e]);
+                if (op >= 0x36 && op <= 0x3a) // istore to astore
+                    return store(i.operand, slot_size(BY_TYPE[op - 0x36]));
+                if (op >= 0x3b && op <= 0x4e) // istore_0 to astore_3
+                    return store((op - 0x3b) % 4, slot_size(BY_TYPE[(op - 0x3b) / 4]));
+
+                switch (op)
+                {
+                case 0x59: // dup
+                    return dup(1, 0);
+                case 0x5a: // dup_x1
+                    return dup(1, 1);
+                case 0x5b: // dup_x2
+                    return dup(1, 2);
+                case 0x5c: // dup2
+                    return dup(2, 0);
+                case 0x5d: // dup2_x1
+                    return dup(2, 1);
+                case 0x5e: // dup2_x2
+                    return dup(2, 2);
+                case 0x5f: // swap
+                    if (height < 2)
+                        return fail("stack underflow, 2 slots needed but " + std::to_string(height) + " present");
+                    std::swap(stack[height - 1], stack[height - 2]);
+                    return true;
+                case 0x84: // iinc
+                    return local_index(i.operand, 1);
+                case 0xa8: // jsr
+                case 0xc9: // jsr_w
+                    return push(SLOT_RETURN_ADDRESS);
+                case 0xa9: // ret
+                    return local_index(i.operand, 1);
+                case 0xbb: // new
+                    return push(uninitialized(i.ip));
+                case 0xc5: // multianewarray
+                    return pop(i.operand2) && push(SLOT_REFERENCE);
+                }
+
+                if (op >= 0x60 && op <= 0x83) // arithmetic, shifts and bitwise
+                {
+                    uint32_t kind = op <= 0x77 ? BY_TYPE[(op - 0x60) % 4] : op <= 0x7d ? BY_TYPE[(op - 0x78) % 2] : BY_TYPE[(op - 0x7e) % 2];
+                    return pop(info.pops) && push(kind);
+                }
+                if (op >= 0x85 && op <= 0x93) // conversions
+                    return pop(info.pops) && push(CONVERSIONS[op - 0x85]);
+
+                switch (info.kind)
+                {
+                case operand_kind::field:
+                    return field(i);
+                case operand_kind::method:
+                case operand_kind::interface_method:
+                case operand_kind::invoke_dynamic:
+                    return invoke(i);
+                case operand_kind::invalid:
+                    return fail("invalid opcode " + std::to_string(op));
+                default:
+                    break;
+                }
+
+                // everything left has a fixed effect and pushes at most one non-wide value: a reference, or an int from
+                // the comparisons, arraylength and instanceof
+                if (!pop(info.pops))
+                    return false;
+                if (!info.pushes)
+                    return true;
+                return push(op == 0xbc || op == 0xbd || op == 0xc0 ? SLOT_REFERENCE : SLOT_INT); // newarray, anewarray, checkcast
+            }
+        };
+
+        // entry frames of all blocks together may hold this many slots per byte of code. ordinary methods need a few, but
+        // max_locals and max_stack are declared freely, and a method with thousands of blocks entered with a deep stack
+        // would otherwise take gigabytes
+        constexpr size_t FRAME_SLOTS_PER_BYTE = 256;
+
+        // one past the highest local any instruction loads, stores or increments, leaving room for a long or double
+        uint16_t touched_locals(const code_attribute& code)
+        {
+            int32_t touched = 0;
+            for_each_raw(code, 0, code.compact.empty() ? code.code.size() : code.compact.size(), 0, [&](const raw_inst& i) {
+                uint8_t op = i.opcode;
+                int32_t index = -1;
+                if ((op >= 0x15 && op <= 0x19) || (op >= 0x36 && op <= 0x3a) || op == 0x84 || op == 0xa9) // xload, xstore, iinc, ret
+                    index = i.operand;
+                else if (op >= 0x1a && op <= 0x2d) // xload_n
+                    index = (op - 0x1a) % 4;
+                else if (op >= 0x3b && op <= 0x4e) // xstore_n
+                    index = (op - 0x3b) % 4;
+                touched = std::max(touched, std::min<int32_t>(index + 2, code.max_locals));
+                return true;
+            });
+            return touched;
+        }
+    } // namespace
+
+    // one method going through a frame_analyzer's buffers
+    struct method_run
+    {
+        frame_analyzer& a;
+        const class_file& clazz;
+        const code_attribute& code;
+        const control_flow_graph& graph;
+        // locals the code touches, which are all that entry frames keep
+        const uint16_t tracked;
+        // slots all entry frames together may take, see FRAME_SLOTS_PER_BYTE
+        const size_t budget;
+        bool too_large = false;
+
+        method_run(frame_analyzer& a, const class_file& clazz, const code_attribute& code, const control_flow_graph& graph, uint16_t tracked)
+            : a(a), clazz(clazz), code(code), graph(graph), tracked(tracked), budget(FRAME_SLOTS_PER_BYTE * code.max_ip)
+        {
+        }
+
+        void report(uint32_t ip, std::string message) { a.result.mismatches.push_back({ip, std::move(message)}); }
+
+        void enqueue(size_t block) { a.pending[block / 64] |= uint64_t(1) << (block % 64); }
+
+        // lowest pending block from `from` on, wrapping around; blocks.size() once there are none
+        size_t dequeue(size_t from)
+        {
+            const size_t words = a.pending.size();
+            for (size_t n = 0; n <= words; n++)
+            {
+                size_t w = (from / 64 + n) % words;
+                uint64_t bits = a.pending[w];
+                if (n == 0)
+                    bits &= ~uint64_t(0) << (from % 64);
+                if (bits)
+                {
+                    size_t block = w * 64 + std::countr_zero(bits);
+                    a.pending[w] &= ~(uint64_t(1) << (block % 64));
+                    return block;
+                }
+            }
+            return graph.size();
+        }
+
+        // makes room for the entry frame of a block reached for the first time, whose height is then fixed
+        bool allocate(size_t block, int32_t height)
+        {
+            size_t size = tracked + height;
+            if (a.entries.size() + size > budget)
+            {
+                too_large = true;
+                return false;
+            }
+            a.entry_offsets[block] = a.entries.size();
+            a.entries.resize(a.entries.size() + size, 0);
+            a.entry_heights[block] = height;
+            return true;
+        }
+
+        // merges a frame into the entry of `block`, queueing it if anything changed
+        void merge(size_t block, const uint32_t* locals, const uint32_t* stack, int32_t height, uint32_t from_ip, bool record)
+        {
+            int32_t entry_height = a.entry_heights[block];
+            if (record)
+            {
+                if (entry_height != height)
+                    report(from_ip, "stack height " + std::to_string(height) + " flows into @" + std::to_string(graph.block_ips[block]) +
+                                        ", which is entered with " + std::to_string(entry_height) + " elsewhere");
+                return;
+            }
+
+            bool changed = entry_height < 0;
+            if (changed)
+            {
+                if (!allocate(block, height))
+                    return;
+                entry_height = height;
+            }
+            uint32_t* entry = a.entries.data() + a.entry_offsets[block];
+            for (size_t i = 0; i < tracked; i++)
+            {
+                uint32_t merged = merge_slot(entry[i], locals[i]);
+                changed |= merged != entry[i];
+                entry[i] = merged;
+            }
+            // a different height is reported by the final pass; the first one reaching the block wins
+            if (entry_height == height)
+            {
+                for (int32_t i = 0; i < height; i++)
+                {
+                    uint32_t merged = merge_slot(entry[tracked + i], stack[i]);
+                    changed |= merged != entry[tracked + i];
+                    entry[tracked + i] = merged;
+                }
+            }
+            if (changed)
+                enqueue(block);
+        }
+
+        void check_frame(const frame_analyzer::declared_frame& f, const uint32_t* locals, const uint32_t* stack, int32_t height)
+        {
+            const uint32_t* expected = a.declared_slots.data() + f.first;
+            if (f.stack != height)
+                report(f.ip, "stack height is " + std::to_string(height) + ", the frame declares " + std::to_string(f.stack));
+            for (size_t i = 0; i < f.locals && i < code.max_locals; i++)
+                if (expected[i] && expected[i] != locals[i])
+                    report(f.ip, "local " + std::to_string(i) + " is " + kind_name(locals[i]) + ", the frame declares " +
+                                     kind_name(expected[i]));
+            for (int32_t i = 0; i < f.stack && i < height; i++)
+                if (expected[f.locals + i] && expected[f.locals + i] != stack[i])
+                    report(f.ip, "stack slot " + std::to_string(i) + " is " + kind_name(stack[i]) + ", the frame declares " +
+                                     kind_name(expected[f.locals + i]));
+        }
+
+        // simulates one block from its entry frame and passes the result on to its successors and handlers. the final
+        // pass records heights, errors and frame mismatches instead of merging
+        void run_block(size_t block, bool record)
+        {
+            uint32_t* frame = a.frame.data();
+            const uint32_t* entry = a.entries.data() + a.entry_offsets[block];
+            std::copy_n(entry, tracked, frame);
+            std::copy_n(entry + tracked, a.entry_heights[block], frame + code.max_locals);
+            std::copy_n(frame, tracked, a.handler_locals.data());
+            machine m(clazz, frame, code.max_locals, tracked, code.max_stack);
+            m.height = a.entry_heights[block];
+
+            auto next_frame = std::lower_bound(a.declared.begin(), a.declared.end(), graph.block_ips[block],
+                                               [](const auto& f, uint32_t ip) { return f.ip < ip; });
+            uint32_t index = graph.block_insts[block];
+            uint32_t last_ip = 0;
+            uint8_t last_opcode = 0;
+            bool ok = true;
+            for_each_raw(code, index, graph.block_insts[block + 1], graph.block_ips[block], [&](const raw_inst& i) {
+                // handlers see the locals from before every instruction that may throw
+                if (m.locals_changed)
+                {
+                    for (size_t l = 0; l < tracked; l++)
+                        a.handler_locals[l] = merge_slot(a.handler_locals[l], frame[l]);
+                    m.locals_changed = false;
+                }
+                if (record)
+                {
+                    a.result.heights[index++] = m.height;
+                    if (next_frame != a.declared.end() && next_frame->ip == i.ip)
+                        check_frame(*next_frame++, frame, frame + code.max_locals, m.height);
+                }
+
+                ok = m.execute(i);
+                if (!ok)
+                {
+                    if (record)
+                        report(i.ip, m.error);
+                    return false;
+                }
+                last_ip = i.ip;
+                last_opcode = i.opcode;
+                return true;
+            });
+
+            // whatever ran before an error can still throw. handlers start with the exception on the stack, which
+            // needs a slot
+            uint32_t exception = SLOT_REFERENCE;
+            if (code.max_stack < 1 && !graph.handlers(block).empty())
+            {
+                if (record)
+                    report(graph.block_ips[block], "stack overflow, max_stack is 0 but the block has exception handlers");
+            }
+            else
+            {
+                for (auto e : graph.handlers(block))
+                    merge(e.handler, a.handler_locals.data(), &exception, 1, graph.block_ips[block], record);
+            }
+            if (!ok)
+                return;
+
+            bool jsr = last_opcode == 0xa8 || last_opcode == 0xc9;
+            for (auto s : graph.successors(block))
+            {
+                // the instruction after a jsr is where ret returns to, without the return address
+                int32_t height = jsr && s == block + 1 ? m.height - 1 : m.height;
+                merge(s, frame, frame + code.max_locals, height, last_ip, record);
+            }
+        }
+    };
+
+    const frame_analysis& frame_analyzer::analyze(const class_file& clazz, const method_info& method, const code_attribute& code,
+                                                  const control_flow_graph& graph)
+    {
+        const size_t blocks = graph.size();
+        result.heights.assign(graph.block_insts.back(), -1);
+        result.mismatches.clear();
+        declared.clear();
+        declared_slots.clear();
+        declared_types.clear();
+        if (!blocks)
+            return result;
+
+        // locals past the ones the code touches stay top throughout, so the working frame has them but entry frames do
+        // not. entry frames are allocated as blocks are reached, with the stack height they are reached with
+        frame.assign(code.max_locals + code.max_stack, SLOT_TOP);
+        entries.clear();
+        entry_offsets.resize(blocks);
+        entry_heights.assign(blocks, -1);
+        pending.assign((blocks + 63) / 64, 0);
+
+        // the entry frame holds the receiver and the parameters, and the stack map's initial frame is the same
+        auto name = method.name_index.get(clazz).bytes;
+        bool constructor = std::string_view((const char*)name.data(), name.size()) == "<init>";
+        if (!(method.access_flags & METHOD_ACC_STATIC))
+            declared_types.push_back(constructor ? SLOT_UNINITIALIZED_THIS : SLOT_REFERENCE);
+        uint32_t ret = for_each_parameter(method.descriptor_index.get(clazz).bytes, [&](uint32_t kind) { declared_types.push_back(kind); });
+        size_t slot = 0;
+        for (auto kind : declared_types)
+        {
+            if (slot + slot_size(kind) > code.max_locals)
+            {
+                ret = BAD_KIND;
+                break;
+            }
+            frame[slot++] = kind;
+            if (slot_size(kind) == 2)
+                frame[slot++] = SLOT_TOP;
+        }
+        method_run run(*this, clazz, code, graph, std::max<uint16_t>(touched_locals(code), slot));
+        if (ret == BAD_KIND)
+        {
+            run.report(0, "malformed method descriptor, or its parameters do not fit max_locals");
+            return result;
+        }
+        handler_locals.resize(run.tracked);
+        if (run.allocate(0, 0))
+        {
+            std::copy_n(frame.begin(), run.tracked, entries.begin());
+            run.enqueue(0);
+        }
+
+        // the declared frames, expanded to slots
+        for (const auto& attr : code.attributes)
+        {
+            const auto* table = std::get_if<stack_map_table_attribute>(&resolve(clazz, attr));
+            if (!table)
+                continue;
+
+            auto expand = [&](uint32_t kind) {
+                declared_slots.push_back(kind);
+                if (slot_size(kind) == 2)
+                    declared_slots.push_back(0);
+            };
+            int64_t ip = -1;
+            for (const auto& f : table->entries)
+            {
+                using namespace stackmap;
+                // locals first, as types; they carry over to the next frame
+                uint16_t delta = std::visit(
+                    [&]<typename T>(const T& data) -> uint16_t {
+                        if constexpr (std::is_same_v<T, stack_map_frame::chop_frame>)
+                            declared_types.resize(declared_types.size() - std::min<size_t>(251 - f.frame_type, declared_types.size()));
+                        else if constexpr (std::is_same_v<T, stack_map_frame::append_frame>)
+                            for (const auto& l : data.locals)
+                                declared_types.push_back(expected_kind(l));
+                        else if constexpr (std::is_same_v<T, stack_map_frame::full_frame>)
+                        {
+                            declared_types.clear();
+                            for (const auto& l : data.locals)
+                                declared_types.push_back(expected_kind(l));
+                        }
+
+                        if constexpr (std::is_same_v<T, stack_map_frame::same_frame>)
+                            return f.frame_type;
+                        else if constexpr (std::is_same_v<T, stack_map_frame::same_locals_1_stack_item_frame>)
+                            return f.frame_type - 64;
+                        else
+                            return data.offset_delta;
+                    },
+                    f.data);
+                ip += delta + 1;
+
+                declared_frame frame{(uint32_t)ip, (uint32_t)declared_slots.size(), 0, 0};
+                for (auto t : declared_types)
+                    expand(t);
+                frame.locals = declared_slots.size() - frame.first;
+                std::visit(
+                    [&]<typename T>(const T& data) {
+                        if constexpr (detail::is_same_any<T, stack_map_frame::same_locals_1_stack_item_frame,
+                                                          stack_map_frame::same_locals_1_stack_item_frame_extended>)
+                            expand(expected_kind(data.stack));
+                        else if constexpr (std::is_same_v<T, stack_map_frame::full_frame>)
+                            for (const auto& item : data.stack)
+                                expand(expected_kind(item));
+                    },
+                    f.data);
+                frame.stack = declared_slots.size() - frame.first - frame.locals;
+                declared.push_back(frame);
+            }
+        }
+
+        for (size_t block = run.dequeue(0); block < blocks && !run.too_large; block = run.dequeue(block))
+            run.run_block(block, false);
+        if (run.too_large)
+        {
+            // heights are only known for some blocks, so none are shown
+            entry_heights.assign(blocks, -1);
+            run.report(0, "the frames of this method need more than " + std::to_string(run.budget) + " slots, it is not simulated");
+        }
+        for (size_t block = 0; block < blocks; block++)
+            if (entry_heights[block] >= 0)
+                run.run_block(block, true);
+
+        std::stable_sort(result.mismatches.begin(), result.mismatches.end(), [](const auto& a, const auto& b) { return a.ip < b.ip; });
+        return result;
+    }
+} // namespace clazz
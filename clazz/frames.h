@@ -0,0 +1,80 @@
+// cSpell:ignore clazz
+#pragma once
+#include "cfg.h"
+#include "clazz.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace clazz
+{
+    // what a local or operand stack slot may hold. the low half is a set of kinds, one for every path reaching the
+    // slot, so that merging two frames is mostly a bitwise or; anything other than a single kind is unusable, like the
+    // verifier's top. an uninitialized slot also holds the ip of its `new` in the high half
+    enum slot_kind : uint32_t
+    {
+        SLOT_TOP = 1 << 0,
+        SLOT_INT = 1 << 1,
+        SLOT_FLOAT = 1 << 2,
+        SLOT_LONG = 1 << 3,
+        SLOT_DOUBLE = 1 << 4,
+        SLOT_REFERENCE = 1 << 5,
+        SLOT_UNINITIALIZED_THIS = 1 << 6,
+        SLOT_UNINITIALIZED = 1 << 7,
+        SLOT_RETURN_ADDRESS = 1 << 8,
+    };
+
+    struct frame_mismatch
+    {
+        uint32_t ip;
+        std::string message;
+    };
+
+    struct frame_analysis
+    {
+        // operand stack height in slots before every instruction, by instruction number; -1 where unreachable
+        std::vector<int32_t> heights;
+        // StackMapTable frames that disagree with the simulation, plus anything that stops it: stack underflow or
+        // overflow, locals out of range and paths meeting with different stack heights. in ip order
+        std::vector<frame_mismatch> mismatches;
+    };
+
+    // simulates the operand stack and locals of method bodies by their kinds, with a worklist over the control flow
+    // graph until the frames at the start of every block stop changing, then checks the result against the method's
+    // StackMapTable. object types are not tracked beyond being references, so frames only disagree on kinds. the buffers
+    // are kept between calls, so one analyzer per thread can go through any number of methods without allocating
+    class frame_analyzer
+    {
+        // entry frames of the reached blocks, back to back from entry_offsets: the locals the code touches, then as many
+        // stack slots as the block's stack height (-1 until reached)
+        std::vector<uint32_t> entries;
+        std::vector<uint32_t> entry_offsets;
+        std::vector<int32_t> entry_heights;
+        // frame of the instruction being simulated
+        std::vector<uint32_t> frame;
+        // every locals state seen in the current block, which is what its exception handlers start from
+        std::vector<uint32_t> handler_locals;
+        // blocks whose entry frame changed since they were last simulated
+        std::vector<uint64_t> pending;
+        // the StackMapTable, expanded to the slots every frame expects (0 for anything) and stored back to back
+        struct declared_frame
+        {
+            uint32_t ip;
+            uint32_t first;
+            uint16_t locals;
+            uint16_t stack;
+        };
+        std::vector<declared_frame> declared;
+        std::vector<uint32_t> declared_slots;
+        // locals of the frame being expanded, one entry per verification type rather than per slot
+        std::vector<uint32_t> declared_types;
+        frame_analysis result;
+
+        friend struct method_run;
+
+    public:
+        // the result stays valid until the next call
+        const frame_analysis& analyze(const class_file& clazz, const method_info& method, const code_attribute& code,
+                                      const control_flow_graph& graph);
+    };
+} // namespace clazz
@@ -0,0 +1,103 @@
+// cSpell:ignore clazz
+#pragma once
+#include <cstdint>
+#include <fcntl.h>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace clazz
+{
+    // read-only view of a whole file; regular files are mmap'd, anything else (pipes, /dev/stdin) is read in one go
+    class mapped_file
+    {
+        const uint8_t* ptr;
+        size_t len;
+        bool mapped;
+        std::vector<uint8_t> owned;
+
+        inline void read_all(int fd)
+        {
+            uint8_t buf[65536];
+            ssize_t n;
+            while ((n = ::read(fd, buf, sizeof(buf))) > 0)
+                owned.insert(owned.end(), buf, buf + n);
+            if (n < 0)
+                throw std::runtime_error("unable to read file");
+            ptr = owned.data();
+            len = owned.size();
+        }
+
+    public:
+        inline mapped_file(const std::string& path) : ptr(nullptr), len(0), mapped(false)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                throw std::runtime_error("unable to open file");
+
+            struct stat st;
+            if (::fstat(fd, &st) < 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("unable to stat file");
+            }
+
+            if (S_ISDIR(st.st_mode))
+            {
+                ::close(fd);
+                throw std::runtime_error("is a directory");
+            }
+
+            try
+            {
+                if (S_ISREG(st.st_mode) && st.st_size > 0)
+                {
+                    void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (p == MAP_FAILED)
+                        read_all(fd);
+                    else
+                    {
+                        ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+                        ptr = (const uint8_t*)p;
+                        len = st.st_size;
+                        mapped = true;
+                    }
+                }
+                else if (!S_ISREG(st.st_mode))
+                    read_all(fd);
+            }
+            catch (...)
+            {
+                ::close(fd);
+                throw;
+            }
+
+            ::close(fd);
+        }
+
+        inline mapped_file(mapped_file&& rhs) noexcept
+            : ptr(std::exchange(rhs.ptr, nullptr)), len(std::exchange(rhs.len, 0)), mapped(std::exchange(rhs.mapped, false)),
+              owned(std::move(rhs.owned))
+        {
+            if (!mapped)
+                ptr = owned.data();
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        inline ~mapped_file()
+        {
+            if (mapped)
+                ::munmap((void*)ptr, len);
+        }
+
+        constexpr std::span<const uint8_t> data() const { return {ptr, len}; }
+        constexpr size_t size() const { return len; }
+    };
+} // namespace clazz
@@ -0,0 +1,90 @@
+// cSpell:ignore clazz mutf
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// scanning of utf8 constants, which hold modified UTF-8: no NUL bytes (U+0000 is C0 80) and supplementary characters
+// as surrogate pairs, so no 4 byte forms. nearly all of their bytes are printable ASCII, which is skipped 32 (AVX2) or
+// 16 (SSE2) bytes at a time; the vector width follows the compiler's target flags, everything else falls back to
+// scalar code
+namespace clazz
+{
+    namespace detail
+    {
+        // number of leading bytes with lo <= b <= hi, both bounds in 0..0x7f
+        inline size_t ascii_range_prefix(const uint8_t* p, size_t n, uint8_t lo, uint8_t hi)
+        {
+            size_t i = 0;
+#if defined(__AVX2__)
+            // bytes >= 0x80 are negative as int8 and fail the lower bound
+            const __m256i below32 = _mm256_set1_epi8((char)(lo - 1)), above32 = _mm256_set1_epi8((char)hi);
+            for (; i + 32 <= n; i += 32)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+                __m256i in = _mm256_andnot_si256(_mm256_cmpgt_epi8(v, above32), _mm256_cmpgt_epi8(v, below32));
+                uint32_t mask = (uint32_t)_mm256_movemask_epi8(in);
+                if (mask != 0xffffffff)
+                    return i + std::countr_one(mask);
+            }
+#endif
+#if defined(__SSE2__)
+            const __m128i below = _mm_set1_epi8((char)(lo - 1)), above = _mm_set1_epi8((char)hi);
+            for (; i + 16 <= n; i += 16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+                __m128i in = _mm_andnot_si128(_mm_cmpgt_epi8(v, above), _mm_cmpgt_epi8(v, below));
+                uint32_t mask = (uint32_t)_mm_movemask_epi8(in);
+                if (mask != 0xffff)
+                    return i + std::countr_one(mask);
+            }
+#endif
+            for (; i < n; i++)
+                if (p[i] < lo || p[i] > hi)
+                    break;
+            return i;
+        }
+    } // namespace detail
+
+    // what escape_str copies as is, isprint in the C locale
+    constexpr bool is_printable(uint8_t b) { return b >= 0x20 && b <= 0x7e; }
+
+    // length of the leading run of printable bytes
+    inline size_t printable_prefix(std::span<const uint8_t> bytes) { return detail::ascii_range_prefix(bytes.data(), bytes.size(), 0x20, 0x7e); }
+
+    // whether the bytes are well formed modified UTF-8. overlong forms are rejected except for the C0 80 encoding of NUL;
+    // surrogate halves are accepted since that is how supplementary characters are stored
+    inline bool is_valid_modified_utf8(std::span<const uint8_t> bytes)
+    {
+        const uint8_t* p = bytes.data();
+        size_t n = bytes.size();
+        size_t i = 0;
+        while (true)
+        {
+            i += detail::ascii_range_prefix(p + i, n - i, 0x01, 0x7f);
+            if (i == n)
+                return true;
+
+            uint8_t lead = p[i];
+            if (lead >= 0xc0 && lead <= 0xdf)
+            {
+                if (i + 1 >= n || (p[i + 1] & 0xc0) != 0x80 || (lead < 0xc2 && !(lead == 0xc0 && p[i + 1] == 0x80)))
+                    return false;
+                i += 2;
+            }
+            else if (lead >= 0xe0 && lead <= 0xef)
+            {
+                if (i + 2 >= n || (p[i + 1] & 0xc0) != 0x80 || (p[i + 2] & 0xc0) != 0x80 || (lead == 0xe0 && p[i + 1] < 0xa0))
+                    return false;
+                i += 3;
+            }
+            else
+                return false; // NUL, stray continuation byte or a 4 byte form
+        }
+    }
+} // namespace clazz
@@ -0,0 +1,188 @@
+// cSpell:ignore clazz
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// opt-in instrumentation: time spent per phase and a few counters, kept per thread and summed at the end. every hook
+// first checks `enabled`, so with stats off each one costs a single well-predicted branch
+namespace clazz::stats
+{
+    // phases are timed exclusively: entering a phase pauses the one it is nested in, so the times add up to the total
+    enum class phase : uint8_t
+    {
+        read,
+        // class structure, members and attributes other than the ones below
+        parse,
+        constant_pool,
+        validate,
+        code,
+        render,
+        write,
+        count,
+    };
+
+    enum class counter : uint8_t
+    {
+        classes,
+        bytes_read,
+        instructions,
+        attributes,
+        arena_blocks,
+        arena_bytes,
+        output_bytes,
+        cache_hits,
+        cache_misses,
+        count,
+    };
+
+    inline constexpr const char* PHASE_NAMES[] = {"read", "parse", "constant_pool", "validate", "code", "render", "write"};
+    inline constexpr const char* COUNTER_NAMES[] = {"classes",      "bytes_read",  "instructions", "attributes",  "arena_blocks",
+                                                    "arena_bytes",  "output_bytes", "cache_hits",  "cache_misses"};
+    static_assert(std::size(PHASE_NAMES) == (size_t)phase::count && std::size(COUNTER_NAMES) == (size_t)counter::count);
+
+    // set once before any work starts
+    inline bool enabled = false;
+
+    struct totals
+    {
+        std::array<uint64_t, (size_t)phase::count> nanos{};
+        std::array<uint64_t, (size_t)counter::count> counters{};
+        std::map<std::string, uint64_t, std::less<>> attributes;
+    };
+
+    namespace detail
+    {
+        using clock = std::chrono::steady_clock;
+
+        struct thread_stats : totals
+        {
+            // innermost running phase, -1 if none, and since when it has been running
+            int current = -1;
+            clock::time_point since;
+        };
+
+        // stats of every thread that ever recorded anything, they outlive their threads so that nothing is lost
+        struct registry
+        {
+            std::mutex lock;
+            std::vector<std::unique_ptr<thread_stats>> threads;
+        };
+
+        inline registry& get_registry()
+        {
+            static registry r;
+            return r;
+        }
+
+        inline thread_stats& local()
+        {
+            thread_local thread_stats* mine = [] {
+                auto& r = get_registry();
+                std::lock_guard g(r.lock);
+                return r.threads.emplace_back(std::make_unique<thread_stats>()).get();
+            }();
+            return *mine;
+        }
+
+        inline void switch_phase(thread_stats& t, int next)
+        {
+            auto now = clock::now();
+            if (t.current >= 0)
+                t.nanos[t.current] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - t.since).count();
+            t.current = next;
+            t.since = now;
+        }
+    } // namespace detail
+
+    inline void add(counter c, uint64_t n = 1)
+    {
+        if (enabled) [[unlikely]]
+            detail::local().counters[(size_t)c] += n;
+    }
+
+    inline void count_attribute(std::string_view name)
+    {
+        if (enabled) [[unlikely]]
+        {
+            auto& t = detail::local();
+            t.counters[(size_t)counter::attributes]++;
+            if (auto it = t.attributes.find(name); it != t.attributes.end())
+                it->second++;
+            else
+                t.attributes.emplace(name, 1);
+        }
+    }
+
+    class scoped_phase
+    {
+        bool active;
+        int previous = -1;
+
+    public:
+        inline scoped_phase(phase p) : active(enabled)
+        {
+            if (active) [[unlikely]]
+            {
+                auto& t = detail::local();
+                previous = t.current;
+                detail::switch_phase(t, (int)p);
+            }
+        }
+
+        scoped_phase(const scoped_phase&) = delete;
+        scoped_phase& operator=(const scoped_phase&) = delete;
+
+        inline ~scoped_phase()
+        {
+            if (active) [[unlikely]]
+                detail::switch_phase(detail::local(), previous);
+        }
+    };
+
+    // upstream for class arenas that counts the blocks they take from the heap
+    class counting_resource : public std::pmr::memory_resource
+    {
+        void* do_allocate(size_t bytes, size_t align) override
+        {
+            add(counter::arena_blocks);
+            add(counter::arena_bytes, bytes);
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t align) override { std::pmr::new_delete_resource()->deallocate(p, bytes, align); }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    inline std::pmr::memory_resource* arena_upstream()
+    {
+        static counting_resource counting;
+        return enabled ? &counting : std::pmr::new_delete_resource();
+    }
+
+    // sums up all threads. only meaningful once no thread is recording anymore
+    inline totals collect()
+    {
+        totals sum;
+        auto& r = detail::get_registry();
+        std::lock_guard g(r.lock);
+        for (const auto& t : r.threads)
+        {
+            for (size_t i = 0; i < sum.nanos.size(); i++)
+                sum.nanos[i] += t->nanos[i];
+            for (size_t i = 0; i < sum.counters.size(); i++)
+                sum.counters[i] += t->counters[i];
+            for (const auto& [name, n] : t->attributes)
+                sum.attributes[name] += n;
+        }
+        return sum;
+    }
+} // namespace clazz::stats
@@ -0,0 +1,413 @@
+// cSpell:ignore clazz xref
+#include "xref.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace clazz::xref
+{
+    static_assert(std::endian::native == std::endian::little, "the index is written in host byte order");
+
+    namespace
+    {
+        // a class record is the class name, its method names (name and descriptor), the distinct member keys it
+        // references, each as u32 length and bytes, then u32 count and record_ref[count]
+        struct record_ref
+        {
+            uint32_t key;
+            uint32_t method;
+            uint16_t ip;
+            uint8_t opcode;
+            uint8_t reserved;
+        };
+
+        constexpr uint32_t NO_KEY = std::numeric_limits<uint32_t>::max();
+
+        constexpr bool is_reference(uint8_t opcode)
+        {
+            return opcode >= 0xb2 && opcode <= 0xba; // getstatic .. invokedynamic
+        }
+
+        void put_u32(std::string& out, uint32_t v) { out.append((const char*)&v, sizeof(v)); }
+
+        void put_str(std::string& out, std::string_view str)
+        {
+            put_u32(out, str.size());
+            out.append(str);
+        }
+
+        const std::span<const uint8_t>* utf8_at(const class_file& clazz, uint16_t index)
+        {
+            if (index == 0 || index > clazz.constant_pool.size())
+                return nullptr;
+            const auto* info = std::get_if<utf8_info>(&clazz.constant_pool[index - 1]);
+            return info ? &info->bytes : nullptr;
+        }
+
+        template <typename T>
+        const T* entry_at(const class_file& clazz, uint16_t index)
+        {
+            if (index == 0 || index > clazz.constant_pool.size())
+                return nullptr;
+            return std::get_if<T>(&clazz.constant_pool[index - 1]);
+        }
+
+        void append(std::string& out, const std::span<const uint8_t>& bytes) { out.append((const char*)bytes.data(), bytes.size()); }
+
+        // the key of the member a field or method instruction refers to, false if the constant is not one
+        bool member_key(const class_file& clazz, int32_t index, std::string& key)
+        {
+            if (index < 1 || (size_t)index > clazz.constant_pool.size())
+                return false;
+
+            uint16_t owner_index = 0, nat_index = 0;
+            bool field = false;
+            std::visit(
+                [&]<typename T>(const T& info) {
+                    if constexpr (std::is_same_v<T, fieldref_info> || std::is_same_v<T, methodref_info> ||
+                                  std::is_same_v<T, interface_methodref_info>)
+                    {
+                        owner_index = info.class_index.get_index();
+                        nat_index = info.name_and_type_index.get_index();
+                        field = std::is_same_v<T, fieldref_info>;
+                    }
+                    else if constexpr (std::is_same_v<T, invoke_dynamic_info>)
+                        nat_index = info.name_and_type_index.get_index();
+                },
+                clazz.constant_pool[index - 1]);
+
+            const auto* nat = entry_at<name_and_type_info>(clazz, nat_index);
+            if (!nat)
+                return false;
+            const auto* name = utf8_at(clazz, nat->name_index.get_index());
+            const auto* desc = utf8_at(clazz, nat->descriptor_index.get_index());
+            if (!name || !desc)
+                return false;
+
+            key.clear();
+            if (owner_index)
+            {
+                const auto* owner = entry_at<class_info>(clazz, owner_index);
+                const auto* owner_name = owner ? utf8_at(clazz, owner->name_index.get_index()) : nullptr;
+                if (!owner_name)
+                    return false;
+                append(key, *owner_name);
+            }
+            key += '.';
+            append(key, *name);
+            if (field)
+                key += ':';
+            append(key, *desc);
+            return true;
+        }
+
+        // reads a class record, throwing class_parse_error if it is cut short
+        class record_reader
+        {
+            std::string_view data;
+
+        public:
+            record_reader(std::string_view data) : data(data) {}
+
+            void need(size_t n) const
+            {
+                if (data.size() < n)
+                    throw class_parse_error("truncated cross-reference record");
+            }
+
+            uint32_t u32()
+            {
+                need(sizeof(uint32_t));
+                uint32_t v;
+                std::memcpy(&v, data.data(), sizeof(v));
+                data.remove_prefix(sizeof(v));
+                return v;
+            }
+
+            std::string_view str()
+            {
+                uint32_t n = u32();
+                need(n);
+                auto s = data.substr(0, n);
+                data.remove_prefix(n);
+                return s;
+            }
+
+            record_ref ref()
+            {
+                need(sizeof(record_ref));
+                record_ref r;
+                std::memcpy(&r, data.data(), sizeof(r));
+                data.remove_prefix(sizeof(r));
+                return r;
+            }
+
+            bool empty() const { return data.empty(); }
+        };
+
+        uint64_t align8(uint64_t v) { return (v + 7) & ~uint64_t(7); }
+    } // namespace
+
+    void write_class_refs(const class_file& clazz, std::string& out)
+    {
+        auto name = clazz.this_class.get(clazz).name_index.get(clazz).bytes;
+        put_str(out, std::string_view((const char*)name.data(), name.size()));
+
+        put_u32(out, clazz.methods.size());
+        std::string str;
+        for (const auto& m : clazz.methods)
+        {
+            str.clear();
+            append(str, m.name_index.get(clazz).bytes);
+            append(str, m.descriptor_index.get(clazz).bytes);
+            put_str(out, str);
+        }
+
+        // keys are built once per constant, however often it is used
+        std::vector<uint32_t> key_of(clazz.constant_pool.size() + 1, NO_KEY);
+        std::string keys;
+        uint32_t key_count = 0;
+        std::vector<record_ref> refs;
+        auto add = [&](uint32_t method, uint32_t ip, uint8_t opcode, int32_t operand) {
+            if (!is_reference(opcode) || operand < 1 || (size_t)operand > clazz.constant_pool.size())
+                return;
+            if (key_of[operand] == NO_KEY)
+            {
+                if (!member_key(clazz, operand, str))
+                    return;
+                key_of[operand] = key_count++;
+                put_str(keys, str);
+            }
+            refs.push_back({key_of[operand], method, (uint16_t)ip, opcode, 0});
+        };
+
+        for (uint32_t m = 0; m < clazz.methods.size(); m++)
+        {
+            for (const auto& attr : clazz.methods[m].attributes)
+            {
+                const auto* code = std::get_if<code_attribute>(&resolve(clazz, attr));
+                if (!code)
+                    continue;
+                if (!code->compact.empty())
+                {
+                    for (auto i : code->compact)
+                        add(m, i.ip(), i.opcode(), i.operand());
+                }
+                else
+                {
+                    uint32_t ip = 0;
+                    for (const auto& i : code->code)
+                    {
+                        add(m, ip, i.opcode, raw_operand(i.operand1));
+                        ip += i.inst_sz;
+                    }
+                }
+            }
+        }
+
+        put_u32(out, key_count);
+        out += keys;
+        put_u32(out, refs.size());
+        out.append((const char*)refs.data(), refs.size() * sizeof(record_ref));
+    }
+
+    uint32_t index_builder::intern(std::string_view str)
+    {
+        auto it = ids.find(str);
+        if (it != ids.end())
+            return it->second;
+        uint32_t id = storage.size();
+        ids.emplace(storage.emplace_back(str), id);
+        return id;
+    }
+
+    void index_builder::add(std::string_view record)
+    {
+        record_reader r(record);
+        uint32_t class_name = intern(r.str());
+
+        // only methods that make references become sites
+        std::vector<uint32_t> methods(r.u32());
+        std::vector<uint32_t> site_of(methods.size(), NO_KEY);
+        for (auto& m : methods)
+            m = intern(r.str());
+
+        std::vector<uint32_t> keys(r.u32());
+        for (auto& k : keys)
+            k = intern(r.str());
+
+        uint32_t count = r.u32();
+        r.need((uint64_t)count * sizeof(record_ref));
+        for (uint32_t i = 0; i < count; i++)
+        {
+            record_ref ref = r.ref();
+            if (ref.key >= keys.size() || ref.method >= methods.size())
+                throw class_parse_error("invalid cross-reference record");
+            if (site_of[ref.method] == NO_KEY)
+            {
+                site_of[ref.method] = sites.size();
+                sites.push_back({class_name, methods[ref.method]});
+            }
+            pending.push_back({keys[ref.key], {site_of[ref.method], ref.ip, ref.opcode, 0}});
+        }
+        if (!r.empty())
+            throw class_parse_error("invalid cross-reference record");
+    }
+
+    void index_builder::write(const std::string& path) const
+    {
+        // strings are renumbered in sorted order, which sorts the keys along with them
+        std::vector<uint32_t> order(storage.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return storage[a] < storage[b]; });
+        std::vector<uint32_t> rank(storage.size());
+        for (uint32_t i = 0; i < order.size(); i++)
+            rank[order[i]] = i;
+
+        // postings by key with a counting sort over the string numbers, which keeps input order within a key
+        std::vector<uint32_t> first(storage.size() + 1);
+        for (const auto& p : pending)
+            first[rank[p.key] + 1]++;
+        std::vector<key_entry> keys;
+        for (uint32_t s = 0; s < storage.size(); s++)
+        {
+            if (first[s + 1])
+                keys.push_back({s, first[s]});
+            first[s + 1] += first[s];
+        }
+        keys.push_back({0, (uint32_t)pending.size()});
+        std::vector<posting> postings(pending.size());
+        for (const auto& p : pending)
+            postings[first[rank[p.key]]++] = p.p;
+
+        std::vector<site_entry> renamed(sites.size());
+        for (size_t i = 0; i < sites.size(); i++)
+            renamed[i] = {rank[sites[i].class_name], rank[sites[i].method]};
+
+        std::vector<uint32_t> offsets;
+        offsets.reserve(storage.size() + 1);
+        uint64_t bytes = 0;
+        for (uint32_t id : order)
+        {
+            offsets.push_back(bytes);
+            bytes += storage[id].size();
+        }
+        offsets.push_back(bytes);
+        if (bytes > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("cross-reference index too large");
+
+        file_header h{};
+        std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+        h.version = VERSION;
+        h.string_count = storage.size();
+        h.key_count = keys.size() - 1;
+        h.site_count = renamed.size();
+        h.posting_count = postings.size();
+        h.string_offsets = align8(sizeof(h));
+        h.string_bytes = align8(h.string_offsets + offsets.size() * sizeof(uint32_t));
+        h.keys = align8(h.string_bytes + bytes);
+        h.sites = align8(h.keys + keys.size() * sizeof(key_entry));
+        h.postings = align8(h.sites + renamed.size() * sizeof(site_entry));
+        h.size = h.postings + postings.size() * sizeof(posting);
+
+        std::string temp = path + ".tmp-" + std::to_string(::getpid());
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            uint64_t at = 0;
+            auto pad = [&](uint64_t offset) {
+                static constexpr char PADDING[8] = {};
+                out.write(PADDING, offset - at);
+                at = offset;
+            };
+            auto put = [&](uint64_t offset, const void* data, size_t n) {
+                pad(offset);
+                out.write((const char*)data, n);
+                at += n;
+            };
+            put(0, &h, sizeof(h));
+            put(h.string_offsets, offsets.data(), offsets.size() * sizeof(uint32_t));
+            pad(h.string_bytes);
+            for (uint32_t id : order)
+                put(at, storage[id].data(), storage[id].size());
+            put(h.keys, keys.data(), keys.size() * sizeof(key_entry));
+            put(h.sites, renamed.data(), renamed.size() * sizeof(site_entry));
+            put(h.postings, postings.data(), postings.size() * sizeof(posting));
+            if (!out.flush())
+            {
+                std::remove(temp.c_str());
+                throw std::runtime_error("unable to write index " + path);
+            }
+        }
+        if (std::rename(temp.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temp.c_str());
+            throw std::runtime_error("unable to write index " + path);
+        }
+    }
+
+    index::index(const std::string& path) : file(path)
+    {
+        auto data = file.data();
+        header = (const file_header*)data.data();
+        if (data.size() < sizeof(file_header) || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) || header->version != VERSION ||
+            header->size != data.size())
+            throw std::runtime_error("not a cross-reference index, or one written by another version");
+
+        auto section = [&]<typename T>(std::span<const T>& s, uint64_t offset, uint64_t count) {
+            if (offset % alignof(T) || offset > data.size() || count > (data.size() - offset) / sizeof(T))
+                throw std::runtime_error("damaged cross-reference index");
+            s = {(const T*)(data.data() + offset), (size_t)count};
+        };
+        section(string_offsets, header->string_offsets, (uint64_t)header->string_count + 1);
+        section(string_bytes, header->string_bytes, string_offsets.back());
+        section(keys, header->keys, (uint64_t)header->key_count + 1);
+        section(sites, header->sites, header->site_count);
+        section(postings_, header->postings, header->posting_count);
+    }
+
+    std::string_view index::string(uint32_t id) const
+    {
+        if (id >= string_offsets.size() - 1 || string_offsets[id] > string_offsets[id + 1] || string_offsets[id + 1] > string_bytes.size())
+            throw std::runtime_error("damaged cross-reference index");
+        return {string_bytes.data() + string_offsets[id], string_bytes.data() + string_offsets[id + 1]};
+    }
+
+    std::span<const posting> index::postings(size_t k) const
+    {
+        uint32_t first = keys[k].first_posting, last = keys[k + 1].first_posting;
+        if (first > last || last > postings_.size())
+            throw std::runtime_error("damaged cross-reference index");
+        return postings_.subspan(first, last - first);
+    }
+
+    const site_entry& index::site(uint32_t id) const
+    {
+        if (id >= sites.size())
+            throw std::runtime_error("damaged cross-reference index");
+        return sites[id];
+    }
+
+    std::vector<size_t> index::find(std::string_view query) const
+    {
+        // keys starting with the query are contiguous; of those, only the ones where the query ends at the descriptor
+        // match
+        auto all = keys.first(size());
+        auto it = std::lower_bound(all.begin(), all.end(), query, [&](const key_entry& e, std::string_view q) { return string(e.name) < q; });
+        std::vector<size_t> found;
+        for (; it != all.end(); ++it)
+        {
+            std::string_view k = string(it->name);
+            if (!k.starts_with(query))
+                break;
+            if (k.size() == query.size() || k[query.size()] == '(' || k[query.size()] == ':')
+                found.push_back(it - all.begin());
+        }
+        return found;
+    }
+} // namespace clazz::xref
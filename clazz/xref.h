@@ -0,0 +1,124 @@
+// cSpell:ignore clazz xref
+#pragma once
+#include "clazz.h"
+#include "mapped_file.h"
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// cross-reference index: which methods access which fields and call which methods, over any number of classes.
+//
+// members are keyed by their owner, name and descriptor, the way they are written in Java stack traces: methods as
+// `java/io/PrintStream.println(Ljava/lang/String;)V` and fields as `java/lang/System.out:Ljava/io/PrintStream;`.
+// invokedynamic call sites have no owner, their keys start with the dot: `.run()Ljava/lang/Runnable;`
+//
+// the index file is a file_header followed by the sections it points to, each 8-byte aligned, with all integers in
+// host byte order. strings are sorted, so keys are in string order and can be binary searched in place once the file
+// is mapped
+namespace clazz::xref
+{
+    inline constexpr char MAGIC[4] = {'C', 'L', 'Z', 'X'};
+    inline constexpr uint16_t VERSION = 1;
+
+    struct file_header
+    {
+        char magic[4];
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t string_count;
+        uint32_t key_count;
+        uint32_t site_count;
+        uint32_t posting_count;
+        // of the whole file, so that a truncated file is rejected
+        uint64_t size;
+        // u32[string_count + 1], offsets into the string bytes
+        uint64_t string_offsets;
+        uint64_t string_bytes;
+        // key_entry[key_count + 1], the trailing entry only ends the postings of the last key
+        uint64_t keys;
+        // site_entry[site_count]
+        uint64_t sites;
+        // posting[posting_count], grouped by key and in input order within a key
+        uint64_t postings;
+    };
+
+    struct key_entry
+    {
+        uint32_t name;
+        uint32_t first_posting;
+    };
+
+    // a method that makes references: its class name and its name followed by its descriptor, both as string numbers
+    struct site_entry
+    {
+        uint32_t class_name;
+        uint32_t method;
+    };
+
+    struct posting
+    {
+        uint32_t site;
+        uint16_t ip;
+        // getfield, putstatic, invokevirtual etc., which tells reads from writes and the kind of call
+        uint8_t opcode;
+        uint8_t reserved;
+    };
+
+    // appends the references made by every method of the class to `out`, as one record for index_builder::add. records
+    // are plain bytes, so they can be produced in parallel, cached and merged later
+    void write_class_refs(const class_file& clazz, std::string& out);
+
+    // merges class records into an index. records must be added in a fixed order for the file to come out the same
+    class index_builder
+    {
+        std::deque<std::string> storage;
+        std::unordered_map<std::string_view, uint32_t> ids;
+        std::vector<site_entry> sites;
+        struct pending_posting
+        {
+            uint32_t key;
+            posting p;
+        };
+        std::vector<pending_posting> pending;
+
+        uint32_t intern(std::string_view str);
+
+    public:
+        // throws class_parse_error if the record is malformed
+        void add(std::string_view record);
+
+        // written next to the destination and renamed over it. throws std::runtime_error if that fails
+        void write(const std::string& path) const;
+    };
+
+    // a mapped index file. sections are bounds checked when the file is opened and anything read through them when it
+    // is read, so a damaged file throws std::runtime_error rather than reading out of bounds
+    class index
+    {
+        mapped_file file;
+        const file_header* header;
+        std::span<const uint32_t> string_offsets;
+        std::span<const char> string_bytes;
+        std::span<const key_entry> keys;
+        std::span<const site_entry> sites;
+        std::span<const posting> postings_;
+
+    public:
+        explicit index(const std::string& path);
+
+        std::string_view string(uint32_t id) const;
+
+        size_t size() const { return keys.empty() ? 0 : keys.size() - 1; }
+        std::string_view key(size_t k) const { return string(keys[k].name); }
+        std::span<const posting> postings(size_t k) const;
+        const site_entry& site(uint32_t id) const;
+
+        // keys matching a query, in string order. a query without a descriptor matches the member with any descriptor,
+        // so `Foo.bar` finds every overload of bar and `.run` every invokedynamic site named run
+        std::vector<size_t> find(std::string_view query) const;
+    };
+} // namespace clazz::xref
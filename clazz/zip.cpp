@@ -0,0 +1,199 @@
+// cSpell:ignore clazz
+#include "zip.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <zlib.h>
+
+namespace clazz
+{
+    static constexpr uint32_t LOCAL_HEADER_SIG = 0x04034b50;
+    static constexpr uint32_t CENTRAL_HEADER_SIG = 0x02014b50;
+    static constexpr uint32_t EOCD_SIG = 0x06054b50;
+    static constexpr uint32_t ZIP64_EOCD_SIG = 0x06064b50;
+    static constexpr uint32_t ZIP64_LOCATOR_SIG = 0x07064b50;
+
+    static constexpr size_t EOCD_SIZE = 22;
+    static constexpr size_t CENTRAL_HEADER_SIZE = 46;
+    static constexpr size_t LOCAL_HEADER_SIZE = 30;
+    static constexpr uint64_t MAX_DEFLATE_RATIO = 1032;
+
+    // zip is little-endian, unlike class files
+    static inline uint16_t le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+    static inline uint32_t le32(const uint8_t* p) { return le16(p) | ((uint32_t)le16(p + 2) << 16); }
+    static inline uint64_t le64(const uint8_t* p) { return le32(p) | ((uint64_t)le32(p + 4) << 32); }
+
+    static void check_range(std::span<const uint8_t> buf, uint64_t off, uint64_t len)
+    {
+        if (off > buf.size() || len > buf.size() - off)
+            throw zip_error("truncated archive");
+    }
+
+    static void apply_zip64_extra(zip_entry& entry, const uint8_t* extra, size_t len)
+    {
+        size_t off = 0;
+        while (off + 4 <= len)
+        {
+            uint16_t id = le16(extra + off);
+            uint16_t sz = le16(extra + off + 2);
+            off += 4;
+            if (off + sz > len)
+                break;
+
+            if (id == 0x0001)
+            {
+                // only the fields that overflowed in the central header are present, in this order
+                const uint8_t* p = extra + off;
+                const uint8_t* end = p + sz;
+                if (entry.size == 0xffffffff && p + 8 <= end)
+                    entry.size = le64(p), p += 8;
+                if (entry.compressed_size == 0xffffffff && p + 8 <= end)
+                    entry.compressed_size = le64(p), p += 8;
+                if (entry.local_header_offset == 0xffffffff && p + 8 <= end)
+                    entry.local_header_offset = le64(p);
+                return;
+            }
+
+            off += sz;
+        }
+    }
+
+    zip_archive::zip_archive(const std::string& path) : file(path)
+    {
+        auto buf = file.data();
+        if (buf.size() < EOCD_SIZE)
+            throw zip_error("not a zip archive");
+
+        // the end of central directory record is followed by a comment of up to 64k
+        size_t lower = buf.size() > EOCD_SIZE + 0xffff ? buf.size() - EOCD_SIZE - 0xffff : 0;
+        size_t eocd = buf.size() - EOCD_SIZE;
+        while (le32(buf.data() + eocd) != EOCD_SIG)
+        {
+            if (eocd == lower)
+                throw zip_error("not a zip archive");
+            eocd--;
+        }
+
+        uint64_t count = le16(buf.data() + eocd + 10);
+        uint64_t cd_size = le32(buf.data() + eocd + 12);
+        uint64_t cd_offset = le32(buf.data() + eocd + 16);
+
+        if (eocd >= 20 && le32(buf.data() + eocd - 20) == ZIP64_LOCATOR_SIG)
+        {
+            uint64_t zip64_eocd = le64(buf.data() + eocd - 20 + 8);
+            check_range(buf, zip64_eocd, 56);
+            if (le32(buf.data() + zip64_eocd) != ZIP64_EOCD_SIG)
+                throw zip_error("bad zip64 end of central directory");
+            count = le64(buf.data() + zip64_eocd + 32);
+            cd_size = le64(buf.data() + zip64_eocd + 40);
+            cd_offset = le64(buf.data() + zip64_eocd + 48);
+        }
+
+        check_range(buf, cd_offset, cd_size);
+        entry_list.reserve(std::min<uint64_t>(count, cd_size / CENTRAL_HEADER_SIZE));
+
+        uint64_t off = cd_offset;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            check_range(buf, off, CENTRAL_HEADER_SIZE);
+            const uint8_t* p = buf.data() + off;
+            if (le32(p) != CENTRAL_HEADER_SIG)
+                throw zip_error("bad central directory entry");
+
+            uint16_t name_len = le16(p + 28);
+            uint16_t extra_len = le16(p + 30);
+            uint16_t comment_len = le16(p + 32);
+            check_range(buf, off, CENTRAL_HEADER_SIZE + name_len + extra_len + comment_len);
+
+            zip_entry entry{
+                std::string((const char*)p + CENTRAL_HEADER_SIZE, name_len),
+                le16(p + 8),
+                le16(p + 10),
+                le32(p + 16),
+                le32(p + 20),
+                le32(p + 24),
+                le32(p + 42),
+            };
+            apply_zip64_extra(entry, p + CENTRAL_HEADER_SIZE + name_len, extra_len);
+            entry_list.push_back(std::move(entry));
+
+            off += CENTRAL_HEADER_SIZE + name_len + extra_len + comment_len;
+        }
+    }
+
+    std::vector<uint8_t> zip_archive::read(const zip_entry& entry) const
+    {
+        auto buf = file.data();
+        if (entry.flags & 1)
+            throw zip_error(entry.name + ": encrypted entries are not supported");
+
+        check_range(buf, entry.local_header_offset, LOCAL_HEADER_SIZE);
+        const uint8_t* lh = buf.data() + entry.local_header_offset;
+        if (le32(lh) != LOCAL_HEADER_SIG)
+            throw zip_error(entry.name + ": bad local header");
+
+        // sizes in the local header may be zero when a data descriptor is used, so trust the central directory
+        uint64_t data_off = entry.local_header_offset + LOCAL_HEADER_SIZE + le16(lh + 26) + le16(lh + 28);
+        check_range(buf, data_off, entry.compressed_size);
+        const uint8_t* src = buf.data() + data_off;
+
+        std::vector<uint8_t> out;
+        if (entry.method == 0)
+        {
+            if (entry.compressed_size != entry.size)
+                throw zip_error(entry.name + ": bad stored entry size");
+            out.assign(src, src + entry.size);
+        }
+        else if (entry.method == 8)
+        {
+            // deflate expands by at most 1032:1, a larger size is a lie that would only reserve memory. compressed_size is
+            // within the file, so this can't overflow
+            if (entry.size > (1ull << 32) || entry.size > entry.compressed_size * MAX_DEFLATE_RATIO)
+                throw zip_error(entry.name + ": entry too large");
+            out.resize(entry.size);
+
+            z_stream zs{};
+            if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+                throw zip_error(entry.name + ": unable to initialise inflate");
+
+            uint64_t in_left = entry.compressed_size;
+            uint64_t out_left = entry.size;
+            zs.next_in = (Bytef*)src;
+            zs.next_out = out.data();
+
+            int ret;
+            do
+            {
+                // avail_* are 32 bit, feed large entries in slices
+                uInt in_chunk = (uInt)std::min<uint64_t>(in_left, 1u << 30);
+                uInt out_chunk = (uInt)std::min<uint64_t>(out_left, 1u << 30);
+                zs.avail_in = in_chunk;
+                zs.avail_out = out_chunk;
+                ret = inflate(&zs, Z_NO_FLUSH);
+                in_left -= in_chunk - zs.avail_in;
+                out_left -= out_chunk - zs.avail_out;
+            } while (ret == Z_OK);
+            inflateEnd(&zs);
+
+            if (ret != Z_STREAM_END || out_left)
+                throw zip_error(entry.name + ": corrupt deflate stream");
+        }
+        else
+            throw zip_error(entry.name + ": unsupported compression method " + std::to_string(entry.method));
+
+        // crc32 takes a 32 bit length, entries of 4 GiB and more need the z_size_t one
+        if (::crc32_z(0, out.data(), out.size()) != entry.crc32)
+            throw zip_error(entry.name + ": crc mismatch");
+
+        return out;
+    }
+
+    bool is_archive_path(const std::string& path)
+    {
+        auto ends_with = [&path](const char* ext) {
+            size_t n = std::strlen(ext);
+            return path.size() >= n && std::equal(path.end() - n, path.end(), ext, [](char a, char b) { return std::tolower(a) == b; });
+        };
+        return ends_with(".jar") || ends_with(".zip");
+    }
+} // namespace clazz
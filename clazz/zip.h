@@ -0,0 +1,46 @@
+// cSpell:ignore clazz
+#pragma once
+#include "mapped_file.h"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace clazz
+{
+    class zip_error : public std::runtime_error
+    {
+    public:
+        inline zip_error(const std::string& str) : std::runtime_error(str) {}
+    };
+
+    struct zip_entry
+    {
+        std::string name;
+        uint16_t flags;
+        uint16_t method;
+        uint32_t crc32;
+        uint64_t compressed_size;
+        uint64_t size;
+        uint64_t local_header_offset;
+
+        constexpr bool is_directory() const { return !name.empty() && name.back() == '/'; }
+    };
+
+    // read-only .zip/.jar archive backed by a mapped file; only stored and deflated entries are supported
+    class zip_archive
+    {
+        mapped_file file;
+        std::vector<zip_entry> entry_list;
+
+    public:
+        zip_archive(const std::string& path);
+
+        const std::vector<zip_entry>& entries() const { return entry_list; }
+
+        // inflates a single entry, safe to call concurrently
+        std::vector<uint8_t> read(const zip_entry& entry) const;
+    };
+
+    bool is_archive_path(const std::string& path);
+} // namespace clazz
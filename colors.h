@@ -1,108 +1,126 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <fmt/core.h>
 #include <utility>
 
-constexpr std::string black(const std::string& s) { return fmt::format("\x1b[30m{}\x1b[39m", s); }
-constexpr std::string red(const std::string& s) { return fmt::format("\x1b[31m{}\x1b[39m", s); }
-constexpr std::string green(const std::string& s) { return fmt::format("\x1b[32m{}\x1b[39m", s); }
-constexpr std::string yellow(const std::string& s) { return fmt::format("\x1b[33m{}\x1b[39m", s); }
-constexpr std::string blue(const std::string& s) { return fmt::format("\x1b[34m{}\x1b[39m", s); }
-constexpr std::string magenta(const std::string& s) { return fmt::format("\x1b[35m{}\x1b[39m", s); }
-constexpr std::string cyan(const std::string& s) { return fmt::format("\x1b[36m{}\x1b[39m", s); }
-constexpr std::string bright_black(const std::string& s) { return fmt::format("\x1b[90m{}\x1b[39m", s); }
-constexpr std::string bright_red(const std::string& s) { return fmt::format("\x1b[91m{}\x1b[39m", s); }
-constexpr std::string bright_green(const std::string& s) { return fmt::format("\x1b[92m{}\x1b[39m", s); }
-constexpr std::string bright_yellow(const std::string& s) { return fmt::format("\x1b[93m{}\x1b[39m", s); }
-constexpr std::string bright_blue(const std::string& s) { return fmt::format("\x1b[94m{}\x1b[39m", s); }
-constexpr std::string bright_magenta(const std::string& s) { return fmt::format("\x1b[95m{}\x1b[39m", s); }
-constexpr std::string bright_cyan(const std::string& s) { return fmt::format("\x1b[96m{}\x1b[39m", s); }
-constexpr std::string ansi(const std::string& format, const std::string& s)
-{
-    return fmt::format("\x1b[{}m{}\x1b[0m", format, s);
-}
-constexpr std::string italic(const std::string& str) 
-{
-    return fmt::format("\x1b[3m{}\x1b[23m", str);
-}
+// style policy, picked once at startup before any output is produced. with colours off the helpers below hand their
+// text back untouched instead of formatting it into escape sequences
+inline bool colors_enabled = true;
+
+namespace detail
+{
+    constexpr std::string colorize(std::string_view open, std::string_view close, std::string&& s)
+    {
+        if (!colors_enabled)
+            return std::move(s);
+
+        std::string res;
+        res.reserve(open.size() + s.size() + close.size());
+        res.append(open).append(s).append(close);
+        return res;
+    }
+} // namespace detail
 
+constexpr std::string black(std::string s) { return detail::colorize("\x1b[30m", "\x1b[39m", std::move(s)); }
+constexpr std::string red(std::string s) { return detail::colorize("\x1b[31m", "\x1b[39m", std::move(s)); }
+constexpr std::string green(std::string s) { return detail::colorize("\x1b[32m", "\x1b[39m", std::move(s)); }
+constexpr std::string yellow(std::string s) { return detail::colorize("\x1b[33m", "\x1b[39m", std::move(s)); }
+constexpr std::string blue(std::string s) { return detail::colorize("\x1b[34m", "\x1b[39m", std::move(s)); }
+constexpr std::string magenta(std::string s) { return detail::colorize("\x1b[35m", "\x1b[39m", std::move(s)); }
+constexpr std::string cyan(std::string s) { return detail::colorize("\x1b[36m", "\x1b[39m", std::move(s)); }
+constexpr std::string bright_black(std::string s) { return detail::colorize("\x1b[90m", "\x1b[39m", std::move(s)); }
+constexpr std::string bright_red(std::string s) { return detail::colorize("\x1b[91m", "\x1b[39m", std::move(s)); }
+constexpr std::string bright_green(std::string s) { return detail::colorize("\x1b[92m", "\x1b[39m", std::move(s)); }
+constexpr std::string bright_yellow(std::string s) { return detail::colorize("\x1b[93m", "\x1b[39m", std::move(s)); }
+constexpr std::string bright_blue(std::string s) { return detail::colorize("\x1b[94m", "\x1b[39m", std::move(s)); }
+constexpr std::string bright_magenta(std::string s) { return detail::colorize("\x1b[95m", "\x1b[39m", std::move(s)); }
+constexpr std::string bright_cyan(std::string s) { return detail::colorize("\x1b[96m", "\x1b[39m", std::move(s)); }
+constexpr std::string ansi(const std::string& format, std::string s)
+{
+    return colors_enabled ? fmt::format("\x1b[{}m{}\x1b[0m", format, s) : std::move(s);
+}
+constexpr std::string italic(std::string str) 
+{
+    return detail::colorize("\x1b[3m", "\x1b[23m", std::move(str));
+}
 template <typename... Args>
 constexpr std::string black(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[30m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return black(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string red(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[31m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return red(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string green(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[32m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return green(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string yellow(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[33m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return yellow(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string blue(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[34m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return blue(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string magenta(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[35m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return magenta(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string cyan(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[36m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return cyan(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string bright_black(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[90m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return bright_black(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string bright_red(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[91m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return bright_red(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string bright_green(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[92m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return bright_green(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string bright_yellow(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[93m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return bright_yellow(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string bright_blue(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[94m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return bright_blue(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string bright_magenta(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[95m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return bright_magenta(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string bright_cyan(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[96m{}\x1b[39m", fmt::format(s, std::forward<Args>(args)...));
+    return bright_cyan(fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string ansi(const std::string& format, const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[{}m{}\x1b[0m", format, fmt::format(s, std::forward<Args>(args)...));
+    return ansi(format, fmt::format(s, std::forward<Args>(args)...));
 }
 template <typename... Args>
 constexpr std::string italic(const fmt::format_string<Args...>& s, Args&&... args)
 {
-    return fmt::format("\x1b[3m{}\x1b[23m", fmt::format(s, std::forward<Args>(args)...));
+    return italic(fmt::format(s, std::forward<Args>(args)...));
 }
@@ -0,0 +1,121 @@
+// cSpell:ignore clazz
+#pragma once
+#include "clazz/clazz.h"
+#include "hash.h"
+#include "utils.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// demangled descriptors, shared by all workers. the same few hundred descriptors make up most lookups, within a class
+// as well as across the classes of an archive, so each distinct one is only demangled once. entries are never removed
+// and pointers to them stay valid for the rest of the process; once the table is full, descriptors that are not in it
+// yet are demangled on every use instead
+class descriptor_table
+{
+    struct hasher
+    {
+        using is_transparent = void;
+        inline size_t operator()(std::string_view str) const { return xxh64(str); }
+    };
+
+    struct shard
+    {
+        std::shared_mutex lock;
+        std::unordered_map<std::string, std::string, hasher, std::equal_to<>> entries;
+    };
+
+    inline static constexpr size_t SHARDS = 16;
+    inline static constexpr size_t MAX_SHARD_ENTRIES = 1 << 16;
+
+    std::array<shard, SHARDS> shards;
+
+public:
+    static inline descriptor_table& global()
+    {
+        static descriptor_table table;
+        return table;
+    }
+
+    // demangled form of the raw bytes of a utf8 constant, nullptr if it is not in the table and there is no room left.
+    // invalid descriptors throw just like demangle_type
+    inline const std::string* intern(std::span<const uint8_t> bytes)
+    {
+        std::string_view raw((const char*)bytes.data(), bytes.size());
+        shard& s = shards[xxh64(raw, SHARDS) % SHARDS];
+        {
+            std::shared_lock g(s.lock);
+            if (auto it = s.entries.find(raw); it != s.entries.end())
+                return &it->second;
+        }
+
+        std::string demangled = demangle_type(escape_str(bytes));
+        std::unique_lock g(s.lock);
+        if (s.entries.size() >= MAX_SHARD_ENTRIES)
+            return nullptr;
+        return &s.entries.try_emplace(std::string(raw), std::move(demangled)).first->second;
+    }
+
+    inline std::string demangle(std::span<const uint8_t> bytes)
+    {
+        const std::string* interned = intern(bytes);
+        return interned ? *interned : demangle_type(escape_str(bytes));
+    }
+};
+
+// the global table as seen from one class, indexed by constant pool index so that repeated lookups skip hashing. it is
+// filled concurrently by every thread that renders part of the class, each of which makes it current with a scope
+class class_descriptors
+{
+    const clazz::class_file& clazz;
+    std::unique_ptr<std::atomic<const std::string*>[]> slots;
+
+    inline static thread_local const class_descriptors* current = nullptr;
+
+public:
+    inline explicit class_descriptors(const clazz::class_file& clazz)
+        : clazz(clazz), slots(new std::atomic<const std::string*>[clazz.constant_pool.size() + 1]())
+    {
+    }
+
+    class scope
+    {
+        const class_descriptors* previous;
+
+    public:
+        inline explicit scope(const class_descriptors* descriptors) : previous(current) { current = descriptors; }
+        inline ~scope() { current = previous; }
+
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+    };
+
+    // for handing the current table on to tasks that render parts of the same class
+    static inline const class_descriptors* active() { return current; }
+
+    // demangle_type(escape_str(...)) of a utf8 constant
+    static inline std::string demangle(const clazz::class_file& clazz, clazz::utf8_ref ref)
+    {
+        const auto& bytes = ref.get(clazz).bytes;
+        std::atomic<const std::string*>* slot = current && &current->clazz == &clazz ? &current->slots[ref.get_index()] : nullptr;
+        if (slot)
+        {
+            if (const std::string* cached = slot->load(std::memory_order_acquire))
+                return *cached;
+        }
+
+        if (const std::string* interned = descriptor_table::global().intern(bytes))
+        {
+            if (slot)
+                slot->store(interned, std::memory_order_release);
+            return *interned;
+        }
+        return demangle_type(escape_str(bytes));
+    }
+};
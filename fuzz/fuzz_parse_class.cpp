@@ -0,0 +1,82 @@
+// cSpell:ignore clazz
+// libFuzzer target for the class parser. build with `./build.sh fuzz`; classes from `./build.sh classgen` make a good
+// seed corpus. besides crashes and sanitizer reports it checks that writing a parsed class and parsing it again is
+// stable, which catches fields the parser reads differently from how they were encoded, and builds the control flow
+// graph of every method, simulates its frames and indexes its references. fuzz/seeds holds inputs that once broke it
+// and belong in every corpus: `./bytecode-decomp-fuzz corpus fuzz/seeds`
+#include "../clazz/cfg.h"
+#include "../clazz/class_writer.h"
+#include "../clazz/clazz.h"
+#include "../clazz/frames.h"
+#include "../clazz/xref.h"
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+using namespace clazz;
+
+static void resolve_all(const class_file& clazz, const std::pmr::vector<attribute>& attrs, const method_info* method = nullptr)
+{
+    static frame_analyzer analyzer;
+    for (const auto& attr : attrs)
+    {
+        if (const auto* code = std::get_if<code_attribute>(&resolve(clazz, attr)))
+        {
+            try
+            {
+                auto graph = build_cfg(*code);
+                if (method)
+                    analyzer.analyze(clazz, *method, *code, graph);
+            }
+            catch (const class_parse_error&)
+            {
+                // the parser does not check branch targets, the graph builder does
+            }
+            resolve_all(clazz, code->attributes);
+        }
+    }
+}
+
+static void resolve_all(const class_file& clazz)
+{
+    for (const auto& f : clazz.fields)
+        resolve_all(clazz, f.attributes);
+    for (const auto& m : clazz.methods)
+        resolve_all(clazz, m.attributes, &m);
+    resolve_all(clazz, clazz.attributes);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    const parse_options variants[] = {
+        {.borrow_input = true},
+        {.borrow_input = true, .compact_code = true},
+        {.borrow_input = true, .compact_code = true, .lazy_attributes = true, .validate_utf8 = true},
+    };
+
+    for (const auto& options : variants)
+    {
+        std::vector<uint8_t> written;
+        try
+        {
+            auto clazz = parse_class(std::as_bytes(std::span(data, size)), options);
+            resolve_all(clazz);
+            std::string refs;
+            xref::write_class_refs(clazz, refs);
+            xref::index_builder().add(refs);
+            written = write_class(clazz);
+        }
+        catch (const std::exception&)
+        {
+            // rejecting the input is fine, as long as it happens without crashing
+            continue;
+        }
+
+        // the written class is well formed, so it has to parse and come out the same way again
+        auto again = parse_class(std::as_bytes(std::span(written)), options);
+        if (write_class(again) != written)
+            std::abort();
+    }
+    return 0;
+}
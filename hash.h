@@ -0,0 +1,86 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+// XXH64 (https://github.com/Cyan4973/xxHash), fast enough to hash every input on every run. not cryptographic, only
+// meant for telling unchanged inputs apart
+namespace xxh64_detail
+{
+    inline constexpr uint64_t P1 = 0x9e3779b185ebca87ull;
+    inline constexpr uint64_t P2 = 0xc2b2ae3d27d4eb4full;
+    inline constexpr uint64_t P3 = 0x165667b19e3779f9ull;
+    inline constexpr uint64_t P4 = 0x85ebca77c2b2ae63ull;
+    inline constexpr uint64_t P5 = 0x27d4eb2f165667c5ull;
+
+    inline uint64_t read64(const uint8_t* p)
+    {
+        uint64_t v = 0;
+        if constexpr (std::endian::native == std::endian::little)
+            std::memcpy(&v, p, 8);
+        else
+            for (int i = 7; i >= 0; i--)
+                v = v << 8 | p[i];
+        return v;
+    }
+
+    inline uint32_t read32(const uint8_t* p)
+    {
+        uint32_t v = 0;
+        if constexpr (std::endian::native == std::endian::little)
+            std::memcpy(&v, p, 4);
+        else
+            for (int i = 3; i >= 0; i--)
+                v = v << 8 | p[i];
+        return v;
+    }
+
+    constexpr uint64_t round(uint64_t acc, uint64_t in) { return std::rotl(acc + in * P2, 31) * P1; }
+    constexpr uint64_t merge(uint64_t acc, uint64_t v) { return (acc ^ round(0, v)) * P1 + P4; }
+} // namespace xxh64_detail
+
+inline uint64_t xxh64(std::span<const uint8_t> data, uint64_t seed = 0)
+{
+    using namespace xxh64_detail;
+    const uint8_t* p = data.data();
+    const uint8_t* end = p + data.size();
+    uint64_t h;
+
+    if (data.size() >= 32)
+    {
+        uint64_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+        for (; end - p >= 32; p += 32)
+        {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+        h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    }
+    else
+        h = seed + P5;
+
+    h += data.size();
+    for (; end - p >= 8; p += 8)
+        h = std::rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+    if (end - p >= 4)
+    {
+        h = std::rotl(h ^ (read32(p) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++)
+        h = std::rotl(h ^ (*p * P5), 11) * P1;
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+inline uint64_t xxh64(std::string_view str, uint64_t seed = 0) { return xxh64({(const uint8_t*)str.data(), str.size()}, seed); }
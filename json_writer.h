@@ -0,0 +1,169 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <fmt/format.h>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// streaming JSON writer that appends straight to a buffer, no document is built. strings are taken as the modified
+// UTF-8 of class files: encoded NULs and surrogate halves are written as \u escapes so the output stays valid JSON
+class json_writer
+{
+    fmt::memory_buffer& out;
+    // per open container: whether the next element needs a separator
+    std::vector<bool> needs_comma;
+    bool after_key = false;
+
+    inline void separate()
+    {
+        if (after_key)
+            after_key = false;
+        else if (!needs_comma.empty())
+        {
+            if (needs_comma.back())
+                out.push_back(',');
+            needs_comma.back() = true;
+        }
+    }
+
+    inline void put(std::string_view s) { out.append(s.data(), s.data() + s.size()); }
+
+    inline void put_escaped(std::string_view s)
+    {
+        static constexpr char HEX[] = "0123456789abcdef";
+        auto unicode_escape = [this](uint32_t c) {
+            char buf[6] = {'\\', 'u', HEX[(c >> 12) & 15], HEX[(c >> 8) & 15], HEX[(c >> 4) & 15], HEX[c & 15]};
+            out.append(buf, buf + 6);
+        };
+
+        out.push_back('"');
+        size_t run = 0;
+        for (size_t i = 0; i < s.size(); i++)
+        {
+            uint8_t c = s[i];
+            if (c >= 0x20 && c != '"' && c != '\\' && c != 0xc0 && c != 0xed)
+                continue;
+
+            put(s.substr(run, i - run));
+            run = i + 1;
+            if (c == '"' || c == '\\')
+            {
+                out.push_back('\\');
+                out.push_back(c);
+            }
+            else if (c == '\n')
+                put("\\n");
+            else if (c == '\t')
+                put("\\t");
+            else if (c < 0x20)
+                unicode_escape(c);
+            else if (c == 0xc0 && i + 1 < s.size() && (uint8_t)s[i + 1] == 0x80)
+            {
+                unicode_escape(0);
+                run = ++i + 1;
+            }
+            else if (c == 0xed && i + 2 < s.size() && ((uint8_t)s[i + 1] & 0xe0) == 0xa0)
+            {
+                // surrogate half, which is not valid UTF-8 on its own
+                unicode_escape(0xd000 | ((s[i + 1] & 0x3f) << 6) | (s[i + 2] & 0x3f));
+                i += 2;
+                run = i + 1;
+            }
+            else
+                run = i; // an ordinary lead byte, copied with the rest of the run
+        }
+        put(s.substr(run));
+        out.push_back('"');
+    }
+
+public:
+    inline json_writer(fmt::memory_buffer& out) : out(out) { needs_comma.reserve(16); }
+
+    inline json_writer& begin_object()
+    {
+        separate();
+        out.push_back('{');
+        needs_comma.push_back(false);
+        return *this;
+    }
+
+    inline json_writer& end_object()
+    {
+        out.push_back('}');
+        needs_comma.pop_back();
+        return *this;
+    }
+
+    inline json_writer& begin_array()
+    {
+        separate();
+        out.push_back('[');
+        needs_comma.push_back(false);
+        return *this;
+    }
+
+    inline json_writer& end_array()
+    {
+        out.push_back(']');
+        needs_comma.pop_back();
+        return *this;
+    }
+
+    inline json_writer& key(std::string_view k)
+    {
+        separate();
+        put_escaped(k);
+        out.push_back(':');
+        after_key = true;
+        return *this;
+    }
+
+    inline json_writer& value(std::string_view s)
+    {
+        separate();
+        put_escaped(s);
+        return *this;
+    }
+
+    inline json_writer& value(const char* s) { return value(std::string_view(s)); }
+
+    inline json_writer& value(bool b)
+    {
+        separate();
+        put(b ? "true" : "false");
+        return *this;
+    }
+
+    template <typename T>
+    requires std::is_integral_v<T> json_writer& value(T v)
+    {
+        separate();
+        fmt::format_to(std::back_inserter(out), "{}", v);
+        return *this;
+    }
+
+    // JSON has no nan or infinity, those are written as strings
+    template <typename T>
+    requires std::is_floating_point_v<T> json_writer& value(T v)
+    {
+        if (!std::isfinite(v))
+            return value(std::string_view(std::isnan(v) ? "nan" : v > 0 ? "inf" : "-inf"));
+        separate();
+        fmt::format_to(std::back_inserter(out), "{}", v);
+        return *this;
+    }
+
+    inline json_writer& null()
+    {
+        separate();
+        put("null");
+        return *this;
+    }
+
+    template <typename T>
+    json_writer& field(std::string_view k, const T& v)
+    {
+        return key(k).value(v);
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <fmt/format.h>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+// what an incremental directory run rendered: one line per class with its size, mtime and content hash, keyed by the
+// path relative to the input root, after a header naming the output suffix and the settings the outputs were rendered
+// with. outputs rendered with other settings cannot be reused, but the manifest still says where they are
+class manifest
+{
+    inline static constexpr std::string_view HEADER = "bytecode-decomp manifest 1";
+
+public:
+    struct entry
+    {
+        uint64_t size;
+        int64_t mtime_ns;
+        uint64_t hash;
+    };
+
+    std::string suffix;
+    std::string settings;
+    // when the run that wrote the manifest started. a class modified at or after that moment may have changed again
+    // within the same mtime tick, so its size and mtime alone cannot prove it unchanged
+    int64_t started_ns = 0;
+    std::map<std::string, entry> entries;
+
+    // a missing or unreadable manifest yields an empty one, which makes every class look new
+    static inline manifest load(const std::string& path)
+    {
+        manifest m;
+        std::ifstream in(path);
+        std::string line;
+        if (!std::getline(in, line) || line != HEADER || !std::getline(in, m.suffix) || !std::getline(in, m.settings))
+            return {};
+        if (!std::getline(in, line) || std::sscanf(line.c_str(), "%" SCNd64, &m.started_ns) != 1)
+            return {};
+
+        while (std::getline(in, line))
+        {
+            entry e;
+            int path_start = -1;
+            if (std::sscanf(line.c_str(), "%" SCNu64 " %" SCNd64 " %" SCNx64 " %n", &e.size, &e.mtime_ns, &e.hash, &path_start) != 3 ||
+                path_start < 0)
+                return {};
+            m.entries.emplace(line.substr(path_start), e);
+        }
+        return m;
+    }
+
+    // written next to the destination and renamed over it, so an interrupted run leaves the previous manifest intact
+    inline void save(const std::string& path) const
+    {
+        std::string temp = fmt::format("{}.tmp-{}", path, ::getpid());
+        {
+            std::ofstream out(temp, std::ios::trunc);
+            out << fmt::format("{}\n{}\n{}\n{}\n", HEADER, suffix, settings, started_ns);
+            for (const auto& [name, e] : entries)
+                out << fmt::format("{} {} {:016x} {}\n", e.size, e.mtime_ns, e.hash, name);
+            if (!out.flush())
+            {
+                std::remove(temp.c_str());
+                throw std::runtime_error("unable to write manifest " + path);
+            }
+        }
+        if (std::rename(temp.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temp.c_str());
+            throw std::runtime_error("unable to write manifest " + path);
+        }
+    }
+};
@@ -0,0 +1,210 @@
+#pragma once
+#include "hash.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fmt/format.h>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// on-disk cache of rendered output, addressed by a hash of the input bytes and of everything else the rendering depends
+// on. entries are written to a temporary file and renamed into place, so several processes can share a directory and
+// readers only ever see complete entries. the cache is best effort: any I/O error is treated as a miss. recency is
+// tracked through entry mtimes, which are bumped on every hit and used to evict the least recently used entries once
+// the directory grows past its size limit
+class output_cache
+{
+    struct entry_header
+    {
+        char magic[4];
+        uint32_t reserved;
+        // second hash of the key, guards against collisions of the 64-bit file name
+        uint64_t check;
+        uint64_t size;
+    };
+
+    inline static constexpr char MAGIC[4] = {'B', 'D', 'C', '1'};
+    // stale temporary files of crashed writers are removed after this long
+    inline static constexpr auto TEMP_EXPIRY = std::chrono::hours(1);
+
+    std::string dir;
+    uint64_t max_bytes;
+    std::atomic_uint64_t stored_bytes = 0;
+    std::atomic_uint64_t temp_counter = 0;
+
+    inline std::string entry_path(uint64_t id) const { return fmt::format("{}/{:02x}/{:016x}", dir, id >> 56, id); }
+
+    static inline bool write_all(int fd, const void* data, size_t len)
+    {
+        auto* p = (const char*)data;
+        while (len)
+        {
+            ssize_t n = ::write(fd, p, len);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+public:
+    struct key
+    {
+        uint64_t id;
+        uint64_t check;
+    };
+
+    // the maximum size is a soft limit, it is enforced by trim()
+    inline output_cache(std::string dir, uint64_t max_bytes) : dir(std::move(dir)), max_bytes(max_bytes)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(this->dir, ec);
+        if (ec)
+            throw std::runtime_error(fmt::format("unable to create cache directory {}: {}", this->dir, ec.message()));
+    }
+
+    // `variant` covers whatever besides the input changes the output, e.g. the output format
+    static inline key key_for(std::span<const uint8_t> input, std::string_view variant)
+    {
+        uint64_t seed = xxh64(variant);
+        uint64_t id = xxh64(input, seed);
+        return {id, xxh64(input, ~seed ^ id)};
+    }
+
+    inline std::optional<std::string> lookup(const key& k)
+    {
+        std::string path = entry_path(k.id);
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return std::nullopt;
+
+        entry_header h;
+        std::string data;
+        struct stat st;
+        bool ok = ::fstat(fd, &st) == 0 && ::read(fd, &h, sizeof(h)) == sizeof(h) && !std::memcmp(h.magic, MAGIC, 4) &&
+                  h.check == k.check && h.size == (uint64_t)st.st_size - sizeof(h);
+        if (ok)
+        {
+            data.resize(h.size);
+            size_t got = 0;
+            while (got < data.size())
+            {
+                ssize_t n = ::read(fd, data.data() + got, data.size() - got);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    break;
+                got += n;
+            }
+            ok = got == data.size();
+        }
+        ::close(fd);
+
+        if (!ok)
+            return std::nullopt;
+
+        // a hit makes the entry the most recently used one
+        ::utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+        return data;
+    }
+
+    inline void store(const key& k, std::string_view data)
+    {
+        std::string path = entry_path(k.id);
+        ::mkdir(path.substr(0, path.rfind('/')).c_str(), 0777);
+
+        std::string temp = fmt::format("{}/tmp-{}-{}", dir, ::getpid(), temp_counter.fetch_add(1));
+        int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd < 0)
+            return;
+
+        entry_header h{};
+        std::memcpy(h.magic, MAGIC, 4);
+        h.check = k.check;
+        h.size = data.size();
+        bool ok = write_all(fd, &h, sizeof(h)) && write_all(fd, data.data(), data.size());
+        ok &= ::close(fd) == 0;
+
+        // concurrent writers of the same entry produce the same bytes, whichever rename lands last wins
+        if (!ok || ::rename(temp.c_str(), path.c_str()) != 0)
+        {
+            ::unlink(temp.c_str());
+            return;
+        }
+        stored_bytes.fetch_add(sizeof(h) + data.size());
+    }
+
+    // evicts the least recently used entries until the cache is below its limit again, leaving some headroom so that
+    // the next run does not have to evict right away. only scans the directory if this process added anything
+    inline void trim()
+    {
+        if (stored_bytes.load() == 0)
+            return;
+
+        struct file
+        {
+            std::filesystem::file_time_type used;
+            uint64_t size;
+            std::filesystem::path path;
+        };
+        std::vector<file> files;
+        uint64_t total = 0;
+        auto now = std::filesystem::file_time_type::clock::now();
+
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(dir, ec); !ec && it != std::filesystem::recursive_directory_iterator();
+             it.increment(ec))
+        {
+            if (!it->is_regular_file(ec))
+            {
+                ec.clear();
+                continue;
+            }
+            auto used = it->last_write_time(ec);
+            auto size = it->file_size(ec);
+            if (ec)
+            {
+                // removed by a concurrent trim
+                ec.clear();
+                continue;
+            }
+
+            if (it->path().filename().string().starts_with("tmp-"))
+            {
+                if (now - used > TEMP_EXPIRY)
+                    std::filesystem::remove(it->path(), ec);
+                ec.clear();
+                continue;
+            }
+            files.push_back({used, size, it->path()});
+            total += size;
+        }
+
+        if (total <= max_bytes)
+            return;
+
+        std::sort(files.begin(), files.end(), [](const file& a, const file& b) { return a.used < b.used; });
+        uint64_t target = max_bytes / 10 * 9;
+        for (const auto& f : files)
+        {
+            if (total <= target)
+                break;
+            if (std::filesystem::remove(f.path, ec))
+                total -= f.size;
+        }
+    }
+};
@@ -0,0 +1,287 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// work-stealing pool: every worker owns a deque, pops its own newest task and steals the oldest task of a peer when it
+// runs dry. tasks submitted from a worker go to that worker's deque, so nested work stays local until someone is idle.
+// destruction waits for all submitted tasks
+class task_pool
+{
+    struct worker_queue
+    {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<worker_queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleep_lock;
+    std::condition_variable cv;
+    std::atomic_size_t pending = 0;
+    std::atomic_size_t next_queue = 0;
+    bool stop = false;
+
+    static inline thread_local task_pool* current_pool = nullptr;
+    static inline thread_local size_t current_index = 0;
+
+    size_t home_queue() { return current_pool == this ? current_index : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size(); }
+
+    bool try_pop(size_t self, std::function<void()>& task)
+    {
+        auto& q = *queues[self];
+        std::lock_guard g(q.lock);
+        if (q.tasks.empty())
+            return false;
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool try_steal(size_t self, std::function<void()>& task)
+    {
+        for (size_t i = 1; i < queues.size(); i++)
+        {
+            auto& q = *queues[(self + i) % queues.size()];
+            std::lock_guard g(q.lock);
+            if (q.tasks.empty())
+                continue;
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    bool run_one(size_t self)
+    {
+        std::function<void()> task;
+        if (!try_pop(self, task) && !try_steal(self, task))
+            return false;
+        pending.fetch_sub(1);
+        task();
+        return true;
+    }
+
+    void worker(size_t index)
+    {
+        current_pool = this;
+        current_index = index;
+        while (true)
+        {
+            if (run_one(index))
+                continue;
+
+            std::unique_lock g(sleep_lock);
+            cv.wait(g, [this] { return stop || pending.load() > 0; });
+            if (stop && pending.load() == 0)
+                return;
+        }
+    }
+
+public:
+    inline task_pool(size_t threads)
+    {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; i++)
+            queues.push_back(std::make_unique<worker_queue>());
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; i++)
+            workers.emplace_back([this, i] { worker(i); });
+    }
+
+    task_pool(const task_pool&) = delete;
+    task_pool& operator=(const task_pool&) = delete;
+
+    inline ~task_pool()
+    {
+        {
+            std::lock_guard g(sleep_lock);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto& i : workers)
+            i.join();
+    }
+
+    inline void submit(std::function<void()> task)
+    {
+        auto& q = *queues[home_queue()];
+        {
+            std::lock_guard g(q.lock);
+            q.tasks.push_back(std::move(task));
+        }
+        pending.fetch_add(1);
+        {
+            // pairs with the predicate check in worker() so the wakeup cannot be lost
+            std::lock_guard g(sleep_lock);
+        }
+        cv.notify_one();
+    }
+
+    // runs one queued task on the calling thread, returns false if there was nothing to run
+    inline bool help() { return run_one(home_queue()); }
+
+    // blocks a thread that found nothing to help with until `done` holds or a task is queued. whatever makes `done`
+    // true must call wake_all() afterwards
+    template <typename P>
+    void wait_for(P done)
+    {
+        std::unique_lock g(sleep_lock);
+        cv.wait(g, [&] { return done() || pending.load() > 0; });
+    }
+
+    inline void wake_all()
+    {
+        {
+            // pairs with the predicate check in wait_for() so the wakeup cannot be lost
+            std::lock_guard g(sleep_lock);
+        }
+        cv.notify_all();
+    }
+
+    inline size_t size() const { return workers.size(); }
+};
+
+// parses the value of a -j option. more than 16 threads per core only costs memory and stacks, so larger counts are
+// capped there; anything that is not a positive number throws std::invalid_argument or std::out_of_range
+inline size_t parse_thread_count(const std::string& value)
+{
+    size_t end = 0;
+    long long threads = std::stoll(value, &end);
+    if (end != value.size() || threads <= 0)
+        throw std::invalid_argument("bad thread count: " + value);
+    return std::min<unsigned long long>(threads, std::max(std::thread::hardware_concurrency(), 1u) * 16ull);
+}
+
+// fork-join scope over a task_pool; wait() runs queued tasks itself and only blocks once there are none, so it is safe
+// to call from inside a pool task. the first exception thrown by a task is rethrown from wait()
+class task_group
+{
+    task_pool& pool;
+    std::atomic_size_t outstanding = 0;
+    std::mutex lock;
+    std::exception_ptr error;
+
+    void join()
+    {
+        while (outstanding.load())
+            if (!pool.help())
+                pool.wait_for([this] { return outstanding.load() == 0; });
+    }
+
+public:
+    inline task_group(task_pool& pool) : pool(pool) {}
+
+    inline ~task_group() { join(); }
+
+    inline void run(std::function<void()> task)
+    {
+        outstanding.fetch_add(1);
+        pool.submit([this, &pool = pool, task = std::move(task)]() {
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                std::lock_guard g(lock);
+                if (!error)
+                    error = std::current_exception();
+            }
+            // the group may be gone once outstanding reaches zero, only the pool is left to touch
+            if (outstanding.fetch_sub(1) == 1)
+                pool.wake_all();
+        });
+    }
+
+    inline void wait()
+    {
+        join();
+
+        if (error)
+            std::rethrow_exception(std::exchange(error, nullptr));
+    }
+};
+
+// reorder buffer for results that complete out of order: producers complete() sequence numbers in any order, the
+// owning thread writes them out strictly in sequence as soon as the next one is ready. at most `window` results are
+// in flight, which bounds memory when an early item is slow
+template <typename T>
+class ordered_writer
+{
+    struct slot
+    {
+        bool ready = false;
+        T value;
+    };
+
+    std::vector<slot> slots;
+    size_t next = 0;
+    std::mutex lock;
+    std::condition_variable cv;
+    std::function<void(T&)> write;
+
+    // writes every consecutive ready result, then blocks until `pred` holds
+    template <typename P>
+    void flush_until(P pred)
+    {
+        std::unique_lock g(lock);
+        while (true)
+        {
+            while (slots[next % slots.size()].ready)
+            {
+                slot& s = slots[next % slots.size()];
+                T value = std::move(s.value);
+                s.ready = false;
+                s.value = T();
+                next++;
+
+                g.unlock();
+                write(value);
+                g.lock();
+            }
+
+            if (pred())
+                return;
+            cv.wait(g);
+        }
+    }
+
+public:
+    inline ordered_writer(size_t window, std::function<void(T&)> write) : slots(window), write(std::move(write)) {}
+
+    // called by the owning thread before handing out sequence number `seq`
+    inline void reserve(size_t seq)
+    {
+        flush_until([&] { return seq < next + slots.size(); });
+    }
+
+    // called from any thread once `seq` has been computed
+    inline void complete(size_t seq, T value)
+    {
+        {
+            std::lock_guard g(lock);
+            slot& s = slots[seq % slots.size()];
+            s.value = std::move(value);
+            s.ready = true;
+        }
+        cv.notify_one();
+    }
+
+    // called by the owning thread after the last sequence number has been handed out
+    inline void finish(size_t total)
+    {
+        flush_until([&] { return next >= total; });
+    }
+};
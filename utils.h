@@ -1,8 +1,12 @@
 // cSpell:ignore clazz
 #pragma once
 #include "clazz/clazz.h"
+#include "clazz/mutf8.h"
+#include <algorithm>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 template <typename... Ts>
 struct overload : Ts...
@@ -13,75 +17,101 @@ struct overload : Ts...
 template <class... Ts>
 overload(Ts...) -> overload<Ts...>;
 
-constexpr std::string dup(const std::string& str, size_t n)
+namespace detail
 {
-    std::string out;
-    out.reserve(str.size() * n);
-    for (size_t i = 0; i < n; i++)
-        out += str;
-    return str;
-}
-
-constexpr std::string demangle_type(const std::string& str, size_t index = 0, size_t* out = nullptr)
-{
-    if (out)
-        *out = index + 1;
-    switch (str[index])
+    inline const char* primitive_type_name(char c)
     {
-    case 'Z':
-        return "boolean";
-    case 'B':
-        return "byte";
-    case 'C':
-        return "char";
-    case 'S':
-        return "short";
-    case 'I':
-        return "int";
-    case 'J':
-        return "long";
-    case 'F':
-        return "float";
-    case 'V':
-        return "void";
-    case 'D':
-        return "double";
-    case 'L': {
-        std::string res = "";
-        size_t i;
-        for (i = index + 1; i < str.size() && str[i] != ';'; i++)
-            res += (str[i] == '/' || str[i] == '$') ? '.' : str[i];
-        if (out)
-            *out = i + 1;
-        return res;
+        switch (c)
+        {
+        case 'Z':
+            return "boolean";
+        case 'B':
+            return "byte";
+        case 'C':
+            return "char";
+        case 'S':
+            return "short";
+        case 'I':
+            return "int";
+        case 'J':
+            return "long";
+        case 'F':
+            return "float";
+        case 'V':
+            return "void";
+        case 'D':
+            return "double";
+        default:
+            return nullptr;
+        }
     }
-    case '(': {
-        std::string args;
-        size_t idx = 1;
 
-        while (str[idx] != ')')
+    // appends the field type starting at desc[i] and returns the index after it
+    inline size_t demangle_field_type(std::string_view desc, size_t i, std::string& out)
+    {
+        size_t dimensions = 0;
+        while (i < desc.size() && desc[i] == '[')
         {
-            size_t i;
-            args += demangle_type(str, idx, &i) += ", ";
-            idx = i;
+            dimensions++;
+            i++;
         }
 
-        if (!args.empty())
-            args.erase(args.size() - 2);
+        if (i < desc.size() && desc[i] == 'L')
+        {
+            size_t end = std::min(desc.find(';', i + 1), desc.size());
+            for (i++; i < end; i++)
+                out += (desc[i] == '/' || desc[i] == '$') ? '.' : desc[i];
+            i++;
+        }
+        else if (const char* name = i < desc.size() ? primitive_type_name(desc[i]) : nullptr)
+        {
+            out += name;
+            i++;
+        }
+        else
+            throw std::runtime_error("unable to demangle: " + std::string(desc));
 
-        return demangle_type(str, idx + 1) + "(" + args + ")";
-    }
-    case '[': {
-        size_t arr_count = 0;
-        size_t i;
-        for (i = index; i < str.size() && str[i] == '['; i++)
-            arr_count++;
-        return demangle_type(str, i, out) + dup("[]", i);
+        for (size_t d = 0; d < dimensions; d++)
+            out += "[]";
+        return i;
     }
-    default: {
-        throw std::runtime_error("unable to demangle: " +  str);
+} // namespace detail
+
+// appends the java spelling of a field or method descriptor to `out`, a method as "ret(arg, arg)". works in a single
+// pass without recursion: the arguments are written first and the return type is rotated in front of them
+inline void demangle_type(std::string_view desc, std::string& out)
+{
+    if (desc.empty() || desc[0] != '(')
+    {
+        detail::demangle_field_type(desc, 0, out);
+        return;
     }
+
+    size_t start = out.size();
+    out += '(';
+    size_t i = 1;
+    for (;;)
+    {
+        if (i >= desc.size())
+            throw std::runtime_error("unable to demangle: " + std::string(desc));
+        if (desc[i] == ')')
+            break;
+        if (i > 1)
+            out += ", ";
+        i = detail::demangle_field_type(desc, i, out);
     }
+    out += ')';
+
+    size_t return_type = out.size();
+    detail::demangle_field_type(desc, i + 1, out);
+    std::rotate(out.begin() + start, out.begin() + return_type, out.end());
+}
+
+inline std::string demangle_type(std::string_view desc)
+{
+    std::string out;
+    demangle_type(desc, out);
+    return out;
 }
 
 constexpr std::string get_padding(auto i1, auto i2)
@@ -89,15 +119,22 @@ constexpr std::string get_padding(auto i1, auto i2)
     return std::string(std::to_string(i1).size() - std::to_string(i2).size(), ' ');
 }
 
-constexpr std::string escape_str(const std::vector<uint8_t>& i)
+// printable ASCII is copied in runs, everything else becomes an octal escape
+inline std::string escape_str(std::span<const uint8_t> i)
 {
     std::string out;
-    for (const auto& e : i)
+    out.reserve(i.size());
+    size_t pos = 0;
+    while (pos < i.size())
     {
-        if (!isprint(e))
-            out += "\\0" + std::to_string((e >> 6) & 7) + std::to_string((e >> 3) & 7) + std::to_string((e)&7);
-        else
-            out += e;
+        size_t run = clazz::printable_prefix(i.subspan(pos));
+        out.append((const char*)i.data() + pos, run);
+        for (pos += run; pos < i.size() && !clazz::is_printable(i[pos]); pos++)
+        {
+            uint8_t e = i[pos];
+            const char escape[] = {'\\', '0', char('0' + ((e >> 6) & 7)), char('0' + ((e >> 3) & 7)), char('0' + (e & 7))};
+            out.append(escape, sizeof(escape));
+        }
     }
     return out;
 }